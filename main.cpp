@@ -1,554 +1,5302 @@
-#include <iostream>
-#include <algorithm>
-#include <sstream>
-#include <fstream>
-#include <string>
-#include <vector>
-#include <pthread.h>
-#include <semaphore.h>
-#include <climits>
-#include <limits>
-#include <cstring>
-#include <queue>
-#include <thread>
-#include <chrono>
-#include <mutex>
-#include <map>
-
-using namespace std;
-
-struct Page {
-    int processID;
-    int frameID;
-    int pageNumber;
-    int frequency;
-    int accessTime;
-    int kthAccessTime;
-};
-
-struct Process {
-    int id;
-    int size;
-    bool isFinished;
-    int faultCount;
-    size_t minWorkset;
-    size_t maxWorkset;
-    vector<Page> pages;
-    vector<int> historyPages;
-};
-struct Frame {
-    int id;
-    int pageNumber;
-    int processID;
-};
-
-struct DPT {
-    int processID;
-    int pageNumber;
-    int time;
-};
-
-struct DiskOperation {
-    int processID;
-    int diskAddress;
-    int track;
-    string operationType; 
-    int seekTime = 0;
-};
-
-
-
-vector<Process> processes;
-vector<Frame> diskFrames;
-vector<DPT> dptEntries;
-vector<Page> totalPages;
-
-sem_t mutex_sub, mutex_main;
-sem_t diskQueueSem;
-int g_nX, g_nPageSize;
-string algorithm;
-vector<DiskOperation> diskQueue;
-int currentHeadPosition = 0;
-
-// Void Declarations
-void initSemaphores();
-void destroySemaphores();
-void readFile(const string& filepath);
-void runSimulation(const string& algorithm);
-void accessPage(Process& process, int pageNumber, int currentTime, const string& algorithm);
-void pageFaultHandler(Process& process, int pageNumber, int currentTime, const string& algorithm, int k = 1, const vector<DPT>* futureAccesses = nullptr);
-void simulate();
-void processPage(int idx, const string& algorithm);
-void processWorkset();
-void replacePage(Process& process, const string& algorithm, int currentTime, int k = 1, const vector<DPT>* futureAccesses = nullptr);
-void diskDriverThread();
-void processDiskOperation(const DiskOperation& op);
-void processDisk(int idx);
-void scheduleDiskOperations();
-void processFIFO();
-void processSSTF();
-void processSCAN();
-
-void readFile(const string& filepath) {
-    ifstream file(filepath);
-    if (!file) {
-        cerr << "Unable to open file!" << endl;
-        exit(1);
-    }
-    file >> g_nPageSize >> g_nX;
-    int id, size;
-    while (file >> id >> size) {
-        // Initialize minWorkset to the largest possible size_t value and maxWorkset to 0
-        processes.push_back({id, size, false, 0, std::numeric_limits<size_t>::max(), 0, {}, {}});
-    }
-}
-
-void initSemaphores() {
-    sem_init(&mutex_sub, 0, 0);
-    sem_init(&mutex_main, 0, 0);
-}
-
-void destroySemaphores() {
-    sem_destroy(&mutex_sub);
-    sem_destroy(&mutex_main);
-}
-
-
-
-
-void pageFaultHandler(Process& process, int pageNumber, int currentTime, const string& algorithm, int k, const vector<DPT>* futureAccesses) {
-    if (process.pages.size() >= static_cast<size_t>(process.size)) {
-        replacePage(process, algorithm, currentTime, k, futureAccesses);
-    }
-    // Add the new page
-    Page newPage = {process.id, -1, pageNumber, 1, currentTime, currentTime};
-    process.pages.push_back(newPage);
-    process.faultCount++;
-}
-
-void accessPage(Process& process, int pageNumber, int currentTime, const string& algorithm) {
-    auto it = find_if(process.pages.begin(), process.pages.end(),
-                      [pageNumber](const Page& p) { return p.pageNumber == pageNumber; });
-
-    if (it == process.pages.end()) {
-        pageFaultHandler(process, pageNumber, currentTime, algorithm);
-    } else {
-        it->accessTime = currentTime;
-        it->frequency++;
-        if (process.pages.size() < process.minWorkset) {
-            process.minWorkset = process.pages.size();
-        }
-        if (process.pages.size() > process.maxWorkset) {
-            process.maxWorkset = process.pages.size();
-        }
-    }
-}
-
-void runSimulation(const string& algorithm) {
-    // Assuming dptEntries holds page requests for simulation
-    for (auto& line : dptEntries) {
-        Process& proc = processes[line.processID];
-        if (!proc.isFinished) {
-            accessPage(proc, line.pageNumber, line.time, algorithm);
-        }
-    }
-}
-
-void processDisk(int idx) {
-    DPT& dpt = dptEntries[idx];
-    // Find the corresponding frame
-    auto frameIt = find_if(diskFrames.begin(), diskFrames.end(),
-                           [&](const Frame& f) { return f.pageNumber == dpt.pageNumber && f.processID == dpt.processID; });
-
-    if (frameIt == diskFrames.end()) {
-        // No frame found, simulate disk loading
-        Frame newFrame = {static_cast<int>(diskFrames.size()), dpt.pageNumber, dpt.processID};
-        diskFrames.push_back(newFrame);
-    }
-    // Otherwise, the frame is already loaded (this is simplified)
-}
-
-void processPage(int idx, const string& algorithm) {
-    DPT& dpt = dptEntries[idx];
-    Process& proc = processes[dpt.processID];
-    auto pageIt = find_if(proc.pages.begin(), proc.pages.end(),
-                          [&](const Page& p) { return p.pageNumber == dpt.pageNumber; });
-
-    if (pageIt == proc.pages.end()) {
-        // Page not found, handle page fault
-        pageFaultHandler(proc, dpt.pageNumber, dpt.time, algorithm);
-    } else {
-        // Update page access details
-        pageIt->accessTime = dpt.time;
-        pageIt->frequency++;
-    }
-}
-
-void processWorkset() {
-    for (auto& process : processes) {
-        // Clear pages
-        auto newEnd = remove_if(process.pages.begin(), process.pages.end(),
-                                [&](const Page& p) { return (g_nX < p.accessTime); });
-        process.pages.erase(newEnd, process.pages.end());
-    }
-}
-
-void replacePage(Process& process, const string& algorithm, int currentTime, int k, const vector<DPT>* futureAccesses) {
-    if (process.pages.empty()) return; // No pages to replace
-
-    auto pageIt = process.pages.end(); // Iterator to the page to replace
-
-    if (algorithm == "LIFO") {
-        pageIt = --process.pages.end();
-    } else if (algorithm == "MRU") {
-        pageIt = max_element(process.pages.begin(), process.pages.end(),
-                             [](const Page& a, const Page& b) { return a.accessTime > b.accessTime; });
-    } else if (algorithm == "LRU-X") {
-        pageIt = min_element(process.pages.begin(), process.pages.end(),
-                             [k, currentTime](const Page& a, const Page& b) {
-                                 return (currentTime - a.kthAccessTime) > (currentTime - b.kthAccessTime);
-                             });
-    } else if (algorithm == "LFU") {
-        pageIt = min_element(process.pages.begin(), process.pages.end(),
-                             [](const Page& a, const Page& b) { return a.frequency < b.frequency; });
-    } else if (algorithm == "OPT-lookahead-X" && futureAccesses) {
-        map<int, int> futureAccessMap;
-        for (const DPT& dpt : *futureAccesses) {
-            if (futureAccessMap.find(dpt.pageNumber) == futureAccessMap.end() || futureAccessMap[dpt.pageNumber] > dpt.time) {
-                futureAccessMap[dpt.pageNumber] = dpt.time;
-            }
-        }
-        pageIt = max_element(process.pages.begin(), process.pages.end(),
-                             [&futureAccessMap, currentTime](const Page& a, const Page& b) {
-                                 int aFuture = futureAccessMap.count(a.pageNumber) ? futureAccessMap[a.pageNumber] : INT_MAX;
-                                 int bFuture = futureAccessMap.count(b.pageNumber) ? futureAccessMap[b.pageNumber] : INT_MAX;
-                                 return aFuture > bFuture;
-                             });
-    } else if (algorithm == "WS") {
-        // Implementing the WS
-        int timeThreshold = 10; 
-        pageIt = min_element(process.pages.begin(), process.pages.end(),
-                             [currentTime, timeThreshold](const Page& a, const Page& b) {
-                                 return (currentTime - a.accessTime > timeThreshold);
-                             });
-    }
-
-    if (pageIt != process.pages.end()) {
-        process.pages.erase(pageIt);
-    }
-}
-
-
-void processDiskOperation(const DiskOperation& op) {
-    sem_wait(&mutex_sub);  // Wait for access to the disk queue
-
-    if (op.operationType == "read") {
-        cout << "Reading from disk at track " << op.diskAddress << " for process " << op.processID << endl;
-        // Simulate disk read delay
-    } else if (op.operationType == "write") {
-        cout << "Writing to disk at track " << op.diskAddress << " for process " << op.processID << endl;
-        // Simulate disk write delay
-    }
-
-    sem_post(&mutex_main);  // Signal completion of disk operation
-}
-
-
-// Pre-bonus
-void simulate(const string& algorithm) {
-    for (auto& process : processes) {
-        for (int time = 0; time < 100; ++time) {  // Simulate time slices
-            int pageNum = rand() % 50;  // Random page access
-            accessPage(process, pageNum, time, algorithm);
-        }
-        // Output the process
-        cout << "Process ID: " << process.id << " - Page Faults: " << process.faultCount << endl;
-        if (algorithm == "WS") {  // Only output workset sizes for the Working Set algorithm
-            cout << "Minimum Workset Size: " << process.minWorkset << endl;
-            cout << "Maximum Workset Size: " << process.maxWorkset << endl;
-        }
-    }
-}
-
-/*
-// Resets the state of all processes
-void initProcesses() {
-    for (auto& process : processes) {
-        process.pages.clear();            // Clearing pages might be necessary
-        process.faultCount = 0;           // Reset fault count
-        process.isFinished = false;       // Reset finished state
-        // Any other necessary resets
-    }
-}
-
-// Initializes or resets the disk driver system
-void initDiskDriver() {
-    // Clear the disk queue
-    diskQueue.clear();
-
-    // Reset disk head position or any other necessary states
-    currentHeadPosition = 0;
-
-    // Reinitialize disk-related semaphores if necessary
-    sem_init(&diskQueueSem, 0, 0);
-}
-
-// Ensure this is the only definition of `simulate` in your code.
-void simulate(const string& pageAlgorithm) {
-    vector<string> diskAlgorithms = {"FIFO", "SSTF", "SCAN"};
-
-    for (const auto& diskAlgorithm : diskAlgorithms) {
-        cout << "Running simulation with Page Replacement Algorithm: " << pageAlgorithm
-             << " and Disk Scheduling Algorithm: " << diskAlgorithm << endl;
-
-        initProcesses();     // Initialize or reset processes before each run
-        initDiskDriver();    // Initialize or reset the disk driver
-
-        std::thread diskThread;
-        if (diskAlgorithm == "FIFO") {
-            diskThread = std::thread(processFIFO);
-        } else if (diskAlgorithm == "SSTF") {
-            diskThread = std::thread(processSSTF);
-        } else if (diskAlgorithm == "SCAN") {
-            diskThread = std::thread(processSCAN);
-        }
-
-        // Simulate page requests and manage them based on the algorithm
-        for (auto& line : dptEntries) {
-            Process& proc = processes[line.processID];
-            if (!proc.isFinished) {
-                accessPage(proc, line.pageNumber, line.time, pageAlgorithm);
-            }
-        }
-
-        // Ensure the disk thread completes before moving on
-        if (diskThread.joinable()) {
-            diskThread.join();
-        }
-
-        // Print results after all processing is complete
-        for (const auto& process : processes) {
-            cout << "Process ID: " << process.id << " - Page Faults: " << process.faultCount << endl;
-            if (pageAlgorithm == "WS") {
-                cout << "Minimum Workset Size: " << process.minWorkset << endl;
-                cout << "Maximum Workset Size: " << process.maxWorkset << endl;
-            }
-        }
-    }
-}
-
-*/
-
-
-void diskDriver() {
-    while (true) {
-        sem_wait(&diskQueueSem);  // Wait for an operation to be queued
-
-        if (!diskQueue.empty()) {
-            DiskOperation op = diskQueue.front();
-            diskQueue.erase(diskQueue.begin()); 
-
-            // Simulate disk operation delay
-            std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Simulate disk access time
-
-            processDiskOperation(op);
-
-            sem_post(&mutex_main);  // Signal that disk operation is complete
-        } else {
-            sem_post(&diskQueueSem);  // Prevent deadlock if queue is empty
-        }
-    }
-}
-
-void diskDriverThread() {
-    while (true) {
-        sem_wait(&diskQueueSem);  // Wait for an operation
-        if (!diskQueue.empty()) {
-            DiskOperation op = diskQueue.front();
-            diskQueue.erase(diskQueue.begin());
-            processDiskOperation(op);
-        }
-        sem_post(&diskQueueSem);  // Release the semaphore
-    }
-}
-
-
-int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        cout << "Usage: " << argv[0] << " <config_file> <algorithm>\n";
-        return 1;
-    }
-
-    string config_file = argv[1];
-    string algorithm = argv[2];
-
-    readFile(config_file); // Load data
-
-    vector<string> allAlgorithms = {"LIFO", "MRU", "LRU-X", "LFU", "OPT-lookahead-X", "WS"};
-
-    if (algorithm == "ALL") {
-        for (const auto& alg : allAlgorithms) {
-            cout << "Running: " << alg << endl;
-            initSemaphores();
-            simulate(alg);
-            destroySemaphores();
-        }
-    } else if (find(allAlgorithms.begin(), allAlgorithms.end(), algorithm) != allAlgorithms.end()) {
-        initSemaphores();
-        simulate(algorithm);
-        destroySemaphores();
-    } else {
-        cout << "Invalid algorithm. Please use one of the following: " << endl;
-        for (const auto& alg : allAlgorithms) {
-            cout << alg << ", ";
-        }
-        cout << "or ALL for all algorithms.\n";
-        return 1;
-    }
-    
-    return 0;
-}
-
-
-
-/* Bonus NOT WORKING
-
-void scheduleDiskOperations(const string& algorithm) {
-    sem_wait(&diskQueueSem);  // Synchronize access
-
-    // Handling different scheduling algorithms
-    if (algorithm == "FIFO") {
-        while (!diskQueue.empty()) {
-            processDiskOperation(diskQueue.front());
-            diskQueue.erase(diskQueue.begin());  // Remove the processed operation
-        }
-    } else if (algorithm == "SSTF") {
-        // Shortest Seek Time First scheduling
-        if (!diskQueue.empty()) {
-            auto it = min_element(diskQueue.begin(), diskQueue.end(), [&](const DiskOperation& a, const DiskOperation& b) {
-                return abs(currentHeadPosition - a.diskAddress) < abs(currentHeadPosition - b.diskAddress);
-            });
-            processDiskOperation(*it);
-            currentHeadPosition = it->diskAddress;  // Update head position
-            diskQueue.erase(it);  // Remove the processed operation
-        }
-    } else if (algorithm == "SCAN") {
-        // SCAN or elevator algorithm
-        if (!diskQueue.empty()) {
-            sort(diskQueue.begin(), diskQueue.end(), [&](const DiskOperation& a, const DiskOperation& b) {
-                return a.diskAddress < b.diskAddress;
-            });
-            bool direction = true; // True means ascending
-            for (auto& op : diskQueue) {
-                if ((direction && op.diskAddress >= currentHeadPosition) ||
-                    (!direction && op.diskAddress <= currentHeadPosition)) {
-                    processDiskOperation(op);
-                    currentHeadPosition = op.diskAddress; // Update head position
-                }
-            }
-            diskQueue.clear();  // Clear all operations after processing
-        }
-    }
-
-    sem_post(&diskQueueSem);
-}
-
-
-void processFIFO() {
-    int totalSeekTime = 0;
-    int operationCount = 0;
-    while (!diskQueue.empty()) {
-        DiskOperation op = diskQueue.front();
-        int seekTime = abs(currentHeadPosition - op.diskAddress);
-        totalSeekTime += seekTime;
-        op.seekTime = seekTime;
-        processDiskOperation(op);
-        currentHeadPosition = op.diskAddress;  // Update head position after operation
-        diskQueue.erase(diskQueue.begin());
-        operationCount++;
-    }
-    cout << "Total Seek Time for FIFO: " << totalSeekTime << endl;
-    cout << "Average Seek Time for FIFO: " << (operationCount ? totalSeekTime / operationCount : 0) << endl;
-}
-
-
-
-void processSSTF() {
-    int totalSeekTime = 0;
-    int operationCount = 0;
-    while (!diskQueue.empty()) {
-        auto it = std::min_element(diskQueue.begin(), diskQueue.end(), [&](const DiskOperation& a, const DiskOperation& b) {
-            return abs(currentHeadPosition - a.diskAddress) < abs(currentHeadPosition - b.diskAddress);
-        });
-        DiskOperation op = *it;
-        int seekTime = abs(currentHeadPosition - op.diskAddress);
-        totalSeekTime += seekTime;
-        op.seekTime = seekTime;
-        processDiskOperation(op);
-        currentHeadPosition = op.diskAddress;  // Update head position after operation
-        diskQueue.erase(it);  // Remove the processed operation
-        operationCount++;
-    }
-    cout << "Total Seek Time for SSTF: " << totalSeekTime << endl;
-    cout << "Average Seek Time for SSTF: " << (operationCount ? totalSeekTime / operationCount : 0) << endl;
-}
-
-
-void processSCAN() {
-    bool direction = true;  // true for moving forward/up, false for backward/down
-    int totalSeekTime = 0;
-    int operationCount = 0;
-    while (!diskQueue.empty()) {
-        // Sort elements based on disk address only if needed
-        if (direction) {
-            std::sort(diskQueue.begin(), diskQueue.end(), [](const DiskOperation& a, const DiskOperation& b) {
-                return a.diskAddress < b.diskAddress;
-            });
-        } else {
-            std::sort(diskQueue.begin(), diskQueue.end(), [](const DiskOperation& a, const DiskOperation& b) {
-                return a.diskAddress > b.diskAddress;
-            });
-        }
-
-        std::vector<DiskOperation>::iterator it = direction ?
-            std::find_if(diskQueue.begin(), diskQueue.end(), [&](const DiskOperation& op) {
-                return op.diskAddress >= currentHeadPosition;
-            }) :
-            std::find_if(diskQueue.rbegin(), diskQueue.rend(), [&](const DiskOperation& op) {
-                return op.diskAddress <= currentHeadPosition;
-            }).base();
-
-        if (it != diskQueue.end() && direction) {
-            while (it != diskQueue.end()) {
-                DiskOperation op = *it;
-                int seekTime = abs(currentHeadPosition - op.diskAddress);
-                totalSeekTime += seekTime;
-                op.seekTime = seekTime;
-                processDiskOperation(op);
-                currentHeadPosition = op.diskAddress;
-                it = diskQueue.erase(it);
-                operationCount++;
-            }
-            direction = !direction;  // Change direction
-        } else if (it != diskQueue.begin() && !direction) {
-            do {
-                --it;
-                DiskOperation op = *it;
-                int seekTime = abs(currentHeadPosition - op.diskAddress);
-                totalSeekTime += seekTime;
-                op.seekTime = seekTime;
-                processDiskOperation(op);
-                currentHeadPosition = op.diskAddress;
-                diskQueue.erase(it);
-                operationCount++;
-            } while (it != diskQueue.begin());
-            direction = !direction;  // Change direction
-        } else {
-            direction = !direction;  // Flip direction if no suitable operation found
-        }
-    }
-    cout << "Total Seek Time for SCAN: " << totalSeekTime << endl;
-    cout << "Average Seek Time for SCAN: " << (operationCount ? totalSeekTime / operationCount : 0) << endl;
-}
-
-*/
\ No newline at end of file
+#include <iostream>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <functional>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+// A process's resident pages, stored as columns instead of an array of
+// structs. The page number is only needed on eviction, so it gets a column of
+// its own; the access time and frequency every hit updates are interleaved
+// in a second one so a hit touches a single 8-byte pair. A third column holds
+// the page's state bits (dirty, read ahead), only looked at when read-ahead
+// or writes are simulated. The process ID and frame number that every Page
+// used to carry aren't stored at all. The columns normally live in arena
+// memory sized for the process's frames up front (attach()); a set that was
+// never attached, or outgrows it, moves to memory of its own. Removal swaps
+// the last page into the hole.
+class ResidentSet {
+public:
+    ResidentSet() {}
+    ResidentSet(const ResidentSet& other) { *this = other; }
+
+    // Copies into memory of its own, never into other's arena
+    ResidentSet& operator=(const ResidentSet& other) {
+        if (this == &other) return *this;
+        count = 0;
+        capacity = 0;
+        owned.clear();
+        if (other.count) {
+            reallocate(other.count);
+            copy(other.pages, other.pages + other.count, pages);
+            copy(other.state, other.state + other.count, state);
+            copy(other.hot, other.hot + 2 * other.count, hot);
+            count = other.count;
+        }
+        return *this;
+    }
+
+    enum Flags { DIRTY = 1, PREFETCHED = 2 };
+
+    static size_t intsPerPage() { return 4; }
+
+    // Puts the (empty) set's columns in memory, which holds intsPerPage()
+    // ints for each of `frames` pages
+    void attach(int* memory, size_t frames) {
+        owned.clear();
+        pages = memory;
+        state = memory + frames;
+        hot = memory + 2 * frames;
+        capacity = frames;
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    int pageNumber(int slot) const { return pages[slot]; }
+    int accessTime(int slot) const { return hot[2 * slot]; }
+    int frequency(int slot) const { return hot[2 * slot + 1]; }
+    int flags(int slot) const { return state[slot]; }
+    void setFlags(int slot, int flags) { state[slot] = flags; }
+
+    void touch(int slot, int time) {
+        hot[2 * slot] = time;
+        hot[2 * slot + 1]++;
+    }
+
+    // Adds a page referenced once (or, read ahead, not yet), at time;
+    // returns its slot
+    int push(int pageNumber, int time, int flags = 0) {
+        if (count == capacity) reallocate(max<size_t>(16, capacity * 2));
+        pages[count] = pageNumber;
+        state[count] = flags;
+        hot[2 * count] = time;
+        hot[2 * count + 1] = flags & PREFETCHED ? 0 : 1;
+        return static_cast<int>(count++);
+    }
+
+    // Saves or restores the pages (see SnapshotWriter); a restored set keeps
+    // its arena memory if the pages fit
+    template <class Archive>
+    void transfer(Archive& archive) {
+        uint64_t n = count;
+        archive(n);
+        if (n > capacity) {
+            count = 0;
+            reallocate(static_cast<size_t>(n));
+        }
+        count = static_cast<size_t>(n);
+        archive.block(pages, count);
+        archive.block(state, count);
+        archive.block(hot, 2 * count);
+    }
+
+    // Moves the last page into slot and drops the last slot
+    void removeAt(int slot) {
+        count--;
+        if (static_cast<size_t>(slot) != count) {
+            pages[slot] = pages[count];
+            state[slot] = state[count];
+            hot[2 * slot] = hot[2 * count];
+            hot[2 * slot + 1] = hot[2 * count + 1];
+        }
+    }
+
+private:
+    int* pages = nullptr;
+    int* state = nullptr;  // Flags per slot
+    int* hot = nullptr;  // accessTime, frequency per slot
+    size_t count = 0;
+    size_t capacity = 0;
+    vector<int> owned;   // backing memory when not in an arena
+
+    void reallocate(size_t frames) {
+        vector<int> memory(frames * intsPerPage());
+        copy(pages, pages + count, memory.begin());
+        copy(state, state + count, memory.begin() + frames);
+        copy(hot, hot + 2 * count, memory.begin() + 2 * frames);
+        owned.swap(memory);
+        pages = owned.data();
+        state = owned.data() + frames;
+        hot = owned.data() + 2 * frames;
+        capacity = frames;
+    }
+};
+
+// Open-addressing hash table (linear probing, backward-shift deletion) mapping
+// a page key to the index of its entry in the owning vector. Lookups, inserts
+// and erases are O(1) on average no matter how many pages are resident.
+class PageTable {
+public:
+    static const int NOT_FOUND = -1;
+
+    int find(uint64_t key) const {
+        if (keys.empty()) return NOT_FOUND;
+        for (size_t i = bucket(key);; i = (i + 1) & mask) {
+            if (keys[i] == key) return values[i];
+            if (keys[i] == EMPTY) return NOT_FOUND;
+        }
+    }
+
+    // Inserts key or overwrites its value if it is already present
+    void set(uint64_t key, int value) {
+        if ((used + 1) * 4 > keys.size() * 3) grow();
+        size_t i = bucket(key);
+        while (keys[i] != EMPTY && keys[i] != key) i = (i + 1) & mask;
+        if (keys[i] == EMPTY) used++;
+        keys[i] = key;
+        values[i] = value;
+    }
+
+    void erase(uint64_t key) {
+        if (keys.empty()) return;
+        size_t i = bucket(key);
+        while (keys[i] != key) {
+            if (keys[i] == EMPTY) return;
+            i = (i + 1) & mask;
+        }
+        // Shift later members of the probe chain back so no tombstones are needed
+        for (size_t j = (i + 1) & mask; keys[j] != EMPTY; j = (j + 1) & mask) {
+            size_t home = bucket(keys[j]);
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                keys[i] = keys[j];
+                values[i] = values[j];
+                i = j;
+            }
+        }
+        keys[i] = EMPTY;
+        used--;
+    }
+
+    void clear() {
+        fill(keys.begin(), keys.end(), EMPTY);
+        used = 0;
+    }
+
+    // Pre-size for n keys so a table that stays within n never rehashes
+    void reserve(size_t n) {
+        size_t capacity = 16;
+        while (capacity * 3 < n * 4 + 4) capacity <<= 1;
+        if (capacity > keys.size()) rehash(capacity);
+    }
+
+    size_t size() const { return used; }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(keys);
+        archive(values);
+        archive(mask);
+        archive(used);
+    }
+
+private:
+    static const uint64_t EMPTY = ~0ULL;
+
+    vector<uint64_t> keys;
+    vector<int> values;
+    size_t mask = 0;
+    size_t used = 0;
+
+    size_t bucket(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    }
+
+    void grow() { rehash(keys.empty() ? 16 : keys.size() * 2); }
+
+    void rehash(size_t capacity) {
+        vector<uint64_t> oldKeys(capacity, EMPTY);
+        vector<int> oldValues(capacity);
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        mask = capacity - 1;
+        used = 0;
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] != EMPTY) set(oldKeys[i], oldValues[i]);
+        }
+    }
+};
+
+const int PageTable::NOT_FOUND;
+const uint64_t PageTable::EMPTY;
+
+inline uint64_t pageKey(int pageNumber) {
+    return static_cast<uint32_t>(pageNumber);
+}
+
+inline uint64_t frameKey(int processID, int pageNumber) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(processID)) << 32) | static_cast<uint32_t>(pageNumber);
+}
+
+// Head and tail of one intrusive list threaded through SlotLinks
+struct ListEnds {
+    int head = -1;
+    int tail = -1;
+};
+
+// prev/next links over page slots (indices into Process::pages), shared by
+// any number of intrusive lists. A slot that is on no list has
+// prev == UNLINKED, so membership checks are O(1).
+struct SlotLinks {
+    static const int NIL = -1;
+    static const int UNLINKED = -2;
+
+    vector<int> prev, next;
+
+    bool linked(int slot) const {
+        return slot < static_cast<int>(prev.size()) && prev[slot] != UNLINKED;
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(prev);
+        archive(next);
+    }
+
+    void ensure(int slot) {
+        if (slot >= static_cast<int>(prev.size())) {
+            prev.resize(slot + 1, UNLINKED);
+            next.resize(slot + 1, NIL);
+        }
+    }
+
+    void pushFront(ListEnds& list, int slot) {
+        ensure(slot);
+        prev[slot] = NIL;
+        next[slot] = list.head;
+        if (list.head != NIL) prev[list.head] = slot; else list.tail = slot;
+        list.head = slot;
+    }
+
+    void pushBack(ListEnds& list, int slot) {
+        ensure(slot);
+        next[slot] = NIL;
+        prev[slot] = list.tail;
+        if (list.tail != NIL) next[list.tail] = slot; else list.head = slot;
+        list.tail = slot;
+    }
+
+    void unlink(ListEnds& list, int slot) {
+        int p = prev[slot], n = next[slot];
+        if (p != NIL) next[p] = n; else list.head = n;
+        if (n != NIL) prev[n] = p; else list.tail = p;
+        prev[slot] = UNLINKED;
+    }
+
+    // The page in slot `from` moved to the (unlinked) slot `to`
+    void relocate(ListEnds& list, int from, int to) {
+        ensure(to);
+        int p = prev[from], n = next[from];
+        prev[to] = p;
+        next[to] = n;
+        if (p != NIL) next[p] = to; else list.head = to;
+        if (n != NIL) prev[n] = to; else list.tail = to;
+        prev[from] = UNLINKED;
+    }
+};
+
+const int SlotLinks::NIL;
+const int SlotLinks::UNLINKED;
+
+// A single intrusive list over page slots
+struct SlotList {
+    SlotLinks links;
+    ListEnds ends;
+
+    bool contains(int slot) const { return links.linked(slot); }
+    int front() const { return ends.head; }
+    int back() const { return ends.tail; }
+    void pushFront(int slot) { links.pushFront(ends, slot); }
+    void pushBack(int slot) { links.pushBack(ends, slot); }
+    void erase(int slot) { if (contains(slot)) links.unlink(ends, slot); }
+    void moveToFront(int slot) { links.unlink(ends, slot); links.pushFront(ends, slot); }
+    void relocate(int from, int to) { if (contains(from)) links.relocate(ends, from, to); }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        links.transfer(archive);
+        archive(ends);
+    }
+};
+
+// Indexed binary min-heap over page slots, so a slot's key can be changed or
+// the slot removed in O(log n) without searching for it
+struct SlotHeap {
+    vector<int> heap;     // slots in heap order
+    vector<int> pos;      // slot -> position in heap, -1 if absent
+    vector<int64_t> key;  // slot -> key
+
+    bool empty() const { return heap.empty(); }
+    int top() const { return heap.empty() ? -1 : heap[0]; }
+
+    bool contains(int slot) const {
+        return slot < static_cast<int>(pos.size()) && pos[slot] >= 0;
+    }
+
+    void push(int slot, int64_t k) {
+        if (slot >= static_cast<int>(pos.size())) {
+            pos.resize(slot + 1, -1);
+            key.resize(slot + 1);
+        }
+        key[slot] = k;
+        pos[slot] = static_cast<int>(heap.size());
+        heap.push_back(slot);
+        siftUp(pos[slot]);
+    }
+
+    void update(int slot, int64_t k) {
+        int64_t old = key[slot];
+        key[slot] = k;
+        if (k < old) siftUp(pos[slot]); else siftDown(pos[slot]);
+    }
+
+    void erase(int slot) {
+        if (!contains(slot)) return;
+        int i = pos[slot];
+        int last = heap.back();
+        heap.pop_back();
+        pos[slot] = -1;
+        if (last != slot) {
+            heap[i] = last;
+            pos[last] = i;
+            siftUp(i);
+            siftDown(pos[last]);
+        }
+    }
+
+    // The page in slot `from` moved to the (absent) slot `to`
+    void relocate(int from, int to) {
+        if (!contains(from)) return;
+        if (to >= static_cast<int>(pos.size())) {
+            pos.resize(to + 1, -1);
+            key.resize(to + 1);
+        }
+        key[to] = key[from];
+        pos[to] = pos[from];
+        heap[pos[to]] = to;
+        pos[from] = -1;
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(heap);
+        archive(pos);
+        archive(key);
+    }
+
+private:
+    void place(int i, int slot) {
+        heap[i] = slot;
+        pos[slot] = i;
+    }
+
+    void siftUp(int i) {
+        int slot = heap[i];
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (key[heap[parent]] <= key[slot]) break;
+            place(i, heap[parent]);
+            i = parent;
+        }
+        place(i, slot);
+    }
+
+    void siftDown(int i) {
+        int slot = heap[i];
+        int n = static_cast<int>(heap.size());
+        while (true) {
+            int child = 2 * i + 1;
+            if (child >= n) break;
+            if (child + 1 < n && key[heap[child + 1]] < key[heap[child]]) child++;
+            if (key[slot] <= key[heap[child]]) break;
+            place(i, heap[child]);
+            i = child;
+        }
+        place(i, slot);
+    }
+};
+
+// LFU: a min-heap on (frequency, load order), so the victim is the least
+// frequently used page and, among those, the one loaded first, as the
+// original scan over the load-ordered page list picked. O(log n) per hit.
+// Counts saturate at MAX_FREQUENCY, which keeps them and 2^36 loads in one key.
+struct FrequencyHeap {
+    static const int ORDER_BITS = 36;
+    static const int64_t ORDER_MASK = (int64_t(1) << ORDER_BITS) - 1;
+    static const int64_t MAX_FREQUENCY = (int64_t(1) << (63 - ORDER_BITS)) - 1;
+
+    SlotHeap heap;
+    int64_t loads = 0;
+
+    bool contains(int slot) const { return heap.contains(slot); }
+
+    int victim() const { return heap.top(); }
+
+    void insert(int slot, int frequency) {
+        heap.push(slot, min<int64_t>(frequency, MAX_FREQUENCY) << ORDER_BITS | (loads++ & ORDER_MASK));
+    }
+
+    void touch(int slot) {
+        int64_t key = heap.key[slot];
+        if ((key >> ORDER_BITS) < MAX_FREQUENCY) heap.update(slot, key + (int64_t(1) << ORDER_BITS));
+    }
+
+    void erase(int slot) { heap.erase(slot); }
+    void relocate(int from, int to) { heap.relocate(from, to); }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        heap.transfer(archive);
+        archive(loads);
+    }
+};
+
+const int FrequencyHeap::ORDER_BITS;
+const int64_t FrequencyHeap::ORDER_MASK;
+const int64_t FrequencyHeap::MAX_FREQUENCY;
+
+// OPT-lookahead-X: a page whose next use is within X references is "in the
+// window" and ranked by that next use; anything further out (or never used
+// again) counts as infinitely far, with ties broken least recently used.
+// Pages migrate into the window incrementally as it slides, so nothing is
+// ever rescanned.
+struct LookaheadIndex {
+    static const uint32_t NEVER = UINT32_MAX;
+    static const size_t NO_REFERENCE = SIZE_MAX;  // pos of a page read ahead, not referenced
+
+    // Distance from a trace position to the same page's next reference, read
+    // at nextUse[pos & mask]: the whole trace's index, or a ring over the
+    // lookahead of a streamed trace
+    const uint32_t* nextUse = nullptr;
+    size_t mask = SIZE_MAX;
+    int window = 0;                     // X
+
+    SlotHeap inWindow;  // keyed on -nextUse, so the top is the farthest next use
+    SlotHeap pending;   // out of window but used again, keyed on nextUse
+    SlotList idle;      // every out-of-window page, most recently used first
+
+    // (Re)ranks the page in `slot` after it was referenced at position `pos`
+    void place(int slot, size_t pos) {
+        erase(slot);
+        uint32_t distance = pos == NO_REFERENCE ? NEVER : nextUse[pos & mask];
+        int64_t next = static_cast<int64_t>(pos) + distance;
+        if (distance != NEVER && static_cast<int64_t>(distance) <= window) {
+            inWindow.push(slot, -next);
+        } else {
+            idle.pushFront(slot);
+            if (distance != NEVER) pending.push(slot, next);
+        }
+    }
+
+    // A streamed trace only finds out a page's next use once it is read,
+    // which can be after the page's last reference was simulated
+    void learn(int slot, size_t next) {
+        if (idle.contains(slot) && !pending.contains(slot)) pending.push(slot, static_cast<int64_t>(next));
+    }
+
+    // Slides the window to end at pos + window and picks the page to evict
+    int victim(size_t pos) {
+        while (!pending.empty() && pending.key[pending.top()] - static_cast<int64_t>(pos) <= window) {
+            int slot = pending.top();
+            int64_t next = pending.key[slot];
+            pending.erase(slot);
+            idle.erase(slot);
+            inWindow.push(slot, -next);
+        }
+        return idle.back() >= 0 ? idle.back() : inWindow.top();
+    }
+
+    void erase(int slot) {
+        inWindow.erase(slot);
+        pending.erase(slot);
+        idle.erase(slot);
+    }
+
+    void relocate(int from, int to) {
+        inWindow.relocate(from, to);
+        pending.relocate(from, to);
+        idle.relocate(from, to);
+    }
+
+    // nextUse and mask belong to the run, not the snapshot
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(window);
+        inWindow.transfer(archive);
+        pending.transfer(archive);
+        idle.transfer(archive);
+    }
+};
+
+const uint32_t LookaheadIndex::NEVER;
+const size_t LookaheadIndex::NO_REFERENCE;
+
+// Pages recently evicted, remembered without a frame (ARC's B1/B2, 2Q's
+// A1out). Most recent at the front; lookup, insert and removal are O(1).
+struct GhostList {
+    static const int NONE = -1;
+
+    PageTable index;    // page -> node
+    vector<int> pages;  // node -> page
+    vector<int> freeNodes;
+    SlotList order;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool contains(int page) const { return index.find(pageKey(page)) != PageTable::NOT_FOUND; }
+    // The page's node, or NONE
+    int find(int page) const { return index.find(pageKey(page)); }
+
+    // Returns the page's node, which stays the same until it is removed
+    int pushFront(int page) {
+        int node;
+        if (!freeNodes.empty()) {
+            node = freeNodes.back();
+            freeNodes.pop_back();
+            pages[node] = page;
+        } else {
+            node = static_cast<int>(pages.size());
+            pages.push_back(page);
+        }
+        index.set(pageKey(page), node);
+        order.pushFront(node);
+        count++;
+        return node;
+    }
+
+    // Returns whether the page was there
+    bool erase(int page) {
+        int node = index.find(pageKey(page));
+        if (node == PageTable::NOT_FOUND) return false;
+        remove(node);
+        return true;
+    }
+
+    void popBack() {
+        if (count) remove(order.back());
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        index.transfer(archive);
+        archive(pages);
+        archive(freeNodes);
+        order.transfer(archive);
+        archive(count);
+    }
+
+private:
+    void remove(int node) {
+        index.erase(pageKey(pages[node]));
+        order.erase(node);
+        freeNodes.push_back(node);
+        count--;
+    }
+};
+
+const int GhostList::NONE;
+
+// CLOCK: the resident pages in a ring with reference bits. The hand is the
+// front of the list: a referenced page has its bit cleared and is passed
+// (moved to the back), the first unreferenced one is the victim. New pages
+// go in just behind the hand, with their bit set unless they were read ahead.
+struct ClockRing {
+    SlotList ring;
+    vector<uint8_t> referenced;
+
+    void insert(int slot, bool wasReferenced) {
+        if (slot >= static_cast<int>(referenced.size())) referenced.resize(slot + 1);
+        referenced[slot] = wasReferenced;
+        ring.pushBack(slot);
+    }
+
+    void touch(int slot) { referenced[slot] = 1; }
+
+    int victim() {
+        for (int slot = ring.front(); slot >= 0; slot = ring.front()) {
+            if (!referenced[slot]) return slot;
+            referenced[slot] = 0;
+            ring.erase(slot);
+            ring.pushBack(slot);
+        }
+        return -1;
+    }
+
+    void erase(int slot) { ring.erase(slot); }
+
+    void relocate(int from, int to) {
+        if (!ring.contains(from)) return;
+        ring.relocate(from, to);
+        if (to >= static_cast<int>(referenced.size())) referenced.resize(to + 1);
+        referenced[to] = referenced[from];
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        ring.transfer(archive);
+        archive(referenced);
+    }
+};
+
+// 2Q (Johnson and Shasha, VLDB '94), full version. New pages go through the
+// FIFO a1in and are remembered in a1out after leaving it; only a page that
+// comes back while in a1out gets into the LRU am, so a one-off scan never
+// pushes out the hot set. Kin = c/4 and Kout = c/2 as the paper suggests.
+// A page read ahead goes into a1in unreferenced: its first use is what a
+// fault on it would have been, and if it's never used it isn't remembered.
+struct TwoQueues {
+    enum Unused { USED, FRESH, FROM_A1OUT };
+
+    SlotList am;       // most recently used at the front
+    SlotList a1in;     // oldest at the front
+    GhostList a1out;
+    vector<uint8_t> unused;  // slot -> Unused, for pages read ahead
+    size_t a1inSize = 0;
+    int capacity = 0;
+    bool incomingHot = false;
+
+    // A miss on page, before anything is evicted
+    void miss(int page, bool referenced) { incomingHot = referenced && a1out.erase(page); }
+
+    int victim() const {
+        size_t kin = max(1, capacity / 4);
+        if (a1inSize > 0 && (a1inSize > kin || am.front() < 0)) return a1in.front();
+        return am.back();
+    }
+
+    // The victim leaves its frame; a1in pages are remembered in a1out
+    void evict(int slot, int page) {
+        if (a1in.contains(slot)) {
+            a1in.erase(slot);
+            a1inSize--;
+            if (unused[slot] != FRESH) {
+                a1out.pushFront(page);
+                if (a1out.size() > static_cast<size_t>(max(1, capacity / 2))) a1out.popBack();
+            }
+        } else {
+            am.erase(slot);
+        }
+        unused[slot] = USED;
+    }
+
+    void insert(int slot, int page, bool referenced) {
+        if (slot >= static_cast<int>(unused.size())) unused.resize(slot + 1, USED);
+        unused[slot] = referenced ? USED : a1out.erase(page) ? FROM_A1OUT : FRESH;
+        if (incomingHot) {
+            am.pushFront(slot);
+        } else {
+            a1in.pushBack(slot);
+            a1inSize++;
+        }
+    }
+
+    void touch(int slot) {
+        if (unused[slot] == FROM_A1OUT) {
+            // Back from a1out, as if it had faulted now
+            a1in.erase(slot);
+            a1inSize--;
+            am.pushFront(slot);
+        } else if (am.contains(slot)) {
+            am.moveToFront(slot);  // a1in hits don't count
+        }
+        unused[slot] = USED;
+    }
+
+    void erase(int slot) {
+        if (a1in.contains(slot)) a1inSize--;
+        a1in.erase(slot);
+        am.erase(slot);
+        if (slot < static_cast<int>(unused.size())) unused[slot] = USED;
+    }
+
+    void relocate(int from, int to) {
+        am.relocate(from, to);
+        a1in.relocate(from, to);
+        if (from >= static_cast<int>(unused.size())) return;
+        if (to >= static_cast<int>(unused.size())) unused.resize(to + 1, USED);
+        unused[to] = unused[from];
+        unused[from] = USED;
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        am.transfer(archive);
+        a1in.transfer(archive);
+        a1out.transfer(archive);
+        archive(unused);
+        archive(a1inSize);
+        archive(capacity);
+        archive(incomingHot);
+    }
+};
+
+// ARC (Megiddo and Modha, FAST '03). t1 holds pages seen once recently, t2
+// pages seen at least twice; b1 and b2 remember what each of them evicted.
+// A miss that hits b1 says t1 was too small and moves the target size of t1
+// up, a b2 hit moves it down, and the victim comes from whichever list is
+// over its share. A page read ahead goes into t1 unreferenced, with its ghost
+// (if any) set aside: its first use is what a fault on it would have been,
+// and if it's never used it leaves no ghost of its own.
+struct AdaptiveReplacement {
+    enum Unused { USED, FRESH, FROM_B1, FROM_B2 };
+
+    SlotList t1, t2;    // most recently used at the front
+    GhostList b1, b2;
+    vector<uint8_t> unused;  // slot -> Unused, for pages read ahead
+    size_t t1Size = 0;
+    int capacity = 0;
+    int target = 0;     // p, the target size of t1
+    bool toT2 = false;          // the missing page was in b1 or b2
+    bool incomingInB2 = false;
+    bool ghostVictim = true;    // false when t1 alone fills the cache
+
+    // A miss on page while `resident` pages are in memory, before anything
+    // is evicted: adapts the target and keeps the ghost lists within 2c
+    void miss(int page, size_t resident, bool referenced) {
+        toT2 = incomingInB2 = false;
+        ghostVictim = true;
+        if (referenced && b1.contains(page)) {
+            growT1(b1.size());
+            b1.erase(page);
+            toT2 = true;
+        } else if (referenced && b2.contains(page)) {
+            shrinkT1(b2.size());
+            b2.erase(page);
+            toT2 = incomingInB2 = true;
+        } else if (b1.contains(page) || b2.contains(page)) {
+            // Read ahead: insert() sets the ghost aside
+        } else if (t1Size + b1.size() >= static_cast<size_t>(capacity)) {
+            if (t1Size < static_cast<size_t>(capacity)) b1.popBack(); else ghostVictim = false;
+        } else if (resident + b1.size() + b2.size() >= 2 * static_cast<size_t>(capacity)) {
+            b2.popBack();
+        }
+    }
+
+    int victim(size_t resident) const {
+        size_t t2Size = resident - t1Size;
+        bool fromT1 = t1Size > 0 &&
+            (!ghostVictim || t2Size == 0 || static_cast<int>(t1Size) > target ||
+             (incomingInB2 && static_cast<int>(t1Size) == target));
+        return fromT1 ? t1.back() : t2.back();
+    }
+
+    void evict(int slot, int page) {
+        if (t1.contains(slot)) {
+            t1.erase(slot);
+            t1Size--;
+            if (unused[slot] == FROM_B1) b1.pushFront(page);
+            else if (unused[slot] == FROM_B2) b2.pushFront(page);
+            else if (unused[slot] == USED && ghostVictim) b1.pushFront(page);
+        } else {
+            t2.erase(slot);
+            b2.pushFront(page);
+        }
+        unused[slot] = USED;
+    }
+
+    void insert(int slot, int page, bool referenced) {
+        if (slot >= static_cast<int>(unused.size())) unused.resize(slot + 1, USED);
+        unused[slot] = referenced ? USED : b1.erase(page) ? FROM_B1 : b2.erase(page) ? FROM_B2 : FRESH;
+        if (toT2) {
+            t2.pushFront(slot);
+        } else {
+            t1.pushFront(slot);
+            t1Size++;
+        }
+    }
+
+    void touch(int slot) {
+        Unused from = static_cast<Unused>(unused[slot]);
+        unused[slot] = USED;
+        if (from == FRESH) {
+            t1.moveToFront(slot);  // its first reference
+            return;
+        }
+        // A ghost read back in adapts the target now that it is used, sized
+        // as if it were still on its ghost list
+        if (from == FROM_B1) growT1(b1.size() + 1);
+        if (from == FROM_B2) shrinkT1(b2.size() + 1);
+        if (t1.contains(slot)) {
+            t1.erase(slot);
+            t1Size--;
+            t2.pushFront(slot);
+        } else {
+            t2.moveToFront(slot);
+        }
+    }
+
+    void erase(int slot) {
+        if (t1.contains(slot)) t1Size--;
+        t1.erase(slot);
+        t2.erase(slot);
+        if (slot < static_cast<int>(unused.size())) unused[slot] = USED;
+    }
+
+    void relocate(int from, int to) {
+        t1.relocate(from, to);
+        t2.relocate(from, to);
+        if (from >= static_cast<int>(unused.size())) return;
+        if (to >= static_cast<int>(unused.size())) unused.resize(to + 1, USED);
+        unused[to] = unused[from];
+        unused[from] = USED;
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        t1.transfer(archive);
+        t2.transfer(archive);
+        b1.transfer(archive);
+        b2.transfer(archive);
+        archive(unused);
+        archive(t1Size);
+        archive(capacity);
+        archive(target);
+        archive(toT2);
+        archive(incomingInB2);
+        archive(ghostVictim);
+    }
+
+private:
+    // A hit in b1 (holding b1Size pages with it) grows t1's target, one in
+    // b2 shrinks it, by the ratio of the ghost lists
+    void growT1(size_t b1Size) { target = min(capacity, target + max(1, static_cast<int>(b2.size() / b1Size))); }
+    void shrinkT1(size_t b2Size) { target = max(0, target - max(1, static_cast<int>(b1.size() / b2Size))); }
+};
+
+// CLOCK-Pro (Jiang, Chen and Zhang, USENIX '05). Resident pages are hot or
+// cold. A cold page starts a test period when it comes in, and if it is
+// evicted during it, it stays on the clock as a non-resident entry. A page
+// that faults back in during its test period comes in hot and grows the
+// cold target mc; a test period that runs out shrinks it. Three hands move
+// forward around one circular list: the cold hand finds victims, the hot
+// hand demotes hot pages beyond c - mc, and the test hand ends the oldest
+// test periods once more than c entries are non-resident. New entries go
+// in at the head, just behind the hot hand. mc starts at c/2. A page read
+// ahead comes in cold and unreferenced with no test period of its own; one
+// still listed from its last test period takes its old entry back, so using
+// it before the period ends promotes it when the cold hand comes by.
+class ClockPro {
+public:
+    void configure(int c) {
+        capacity = max(1, c);
+        coldTarget = max(1, capacity / 2);
+    }
+
+    // A miss on page, before anything is evicted
+    void miss(int page, bool referenced) {
+        if (!referenced) return;
+        int n = index.find(pageKey(page));
+        incomingHot = n != PageTable::NOT_FOUND;
+        if (incomingHot) {
+            // Faulted back in during its test period
+            coldTarget = min(max(1, capacity - 1), coldTarget + 1);
+            dropNonResident(n);
+        }
+    }
+
+    int victim() {
+        for (;;) {
+            int n = handCold;
+            handCold = next[n];
+            Node& node = nodes[n];
+            if (node.slot < 0 || node.hot) continue;
+            if (!node.referenced) return node.slot;
+            node.referenced = false;
+            if (node.test) {
+                // Reused during its test period: promote
+                node.hot = true;
+                node.test = false;
+                hotCount++;
+                moveToHead(n);
+                runHotHand();
+            } else {
+                node.test = true;
+                moveToHead(n);
+            }
+        }
+    }
+
+    // The victim leaves its frame; it stays listed if its test period runs
+    void evict(int slot) {
+        int n = slotNode[slot];
+        if (nodes[n].test) {
+            nodes[n].slot = -1;
+            nonResident++;
+            runTestHand();
+        } else {
+            index.erase(pageKey(nodes[n].page));
+            unlink(n);
+        }
+    }
+
+    void insert(int slot, int page, bool referenced) {
+        if (slot >= static_cast<int>(slotNode.size())) slotNode.resize(slot + 1, -1);
+        int n = referenced ? PageTable::NOT_FOUND : index.find(pageKey(page));
+        if (n != PageTable::NOT_FOUND) {
+            nodes[n].slot = slot;
+            nonResident--;
+            slotNode[slot] = n;
+            return;
+        }
+        if (!freeNodes.empty()) {
+            n = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            n = static_cast<int>(nodes.size());
+            nodes.push_back(Node());
+            prev.push_back(-1);
+            next.push_back(-1);
+        }
+        nodes[n] = Node{page, slot, incomingHot, false, referenced && !incomingHot};
+        slotNode[slot] = n;
+        index.set(pageKey(page), n);
+        insertAtHead(n);
+        if (incomingHot) {
+            hotCount++;
+            runHotHand();
+        }
+        incomingHot = false;
+    }
+
+    void touch(int slot) { nodes[slotNode[slot]].referenced = true; }
+
+    void erase(int slot) {
+        if (slot >= static_cast<int>(slotNode.size()) || slotNode[slot] < 0) return;
+        int n = slotNode[slot];
+        if (nodes[n].hot) hotCount--;
+        index.erase(pageKey(nodes[n].page));
+        unlink(n);
+        slotNode[slot] = -1;
+    }
+
+    void relocate(int from, int to) {
+        if (from >= static_cast<int>(slotNode.size()) || slotNode[from] < 0) return;
+        int n = slotNode[from];
+        nodes[n].slot = to;
+        if (to >= static_cast<int>(slotNode.size())) slotNode.resize(to + 1, -1);
+        slotNode[to] = n;
+        slotNode[from] = -1;
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(nodes);
+        archive(prev);
+        archive(next);
+        archive(freeNodes);
+        archive(slotNode);
+        index.transfer(archive);
+        archive(handHot);
+        archive(handCold);
+        archive(handTest);
+        archive(capacity);
+        archive(coldTarget);
+        archive(hotCount);
+        archive(nonResident);
+        archive(incomingHot);
+    }
+
+private:
+    struct Node {
+        int page;
+        int slot;  // -1 when non-resident
+        bool hot;
+        bool referenced;
+        bool test;
+    };
+
+    vector<Node> nodes;
+    vector<int> prev, next;  // circular list over nodes
+    vector<int> freeNodes;
+    vector<int> slotNode;    // slot -> node
+    PageTable index;         // page -> node, resident or not
+    int handHot = -1, handCold = -1, handTest = -1;
+    int capacity = 1;
+    int coldTarget = 1;      // mc
+    int hotCount = 0;
+    int nonResident = 0;
+    bool incomingHot = false;
+
+    void insertAtHead(int n) {
+        if (handHot < 0) {
+            prev[n] = next[n] = n;
+            handHot = handCold = handTest = n;
+            return;
+        }
+        int p = prev[handHot];
+        prev[n] = p;
+        next[n] = handHot;
+        next[p] = n;
+        prev[handHot] = n;
+    }
+
+    void detach(int n) {
+        if (next[n] == n) {
+            handHot = handCold = handTest = -1;
+            return;
+        }
+        if (handHot == n) handHot = next[n];
+        if (handCold == n) handCold = next[n];
+        if (handTest == n) handTest = next[n];
+        next[prev[n]] = next[n];
+        prev[next[n]] = prev[n];
+    }
+
+    void unlink(int n) {
+        detach(n);
+        freeNodes.push_back(n);
+    }
+
+    void moveToHead(int n) {
+        detach(n);
+        insertAtHead(n);
+    }
+
+    void dropNonResident(int n) {
+        index.erase(pageKey(nodes[n].page));
+        unlink(n);
+        nonResident--;
+    }
+
+    void endTest() { coldTarget = max(1, coldTarget - 1); }
+
+    // Demotes hot pages until at most c - mc are hot, ending the test periods
+    // the hand passes on the way
+    void runHotHand() {
+        while (hotCount > capacity - coldTarget) {
+            int n = handHot;
+            handHot = next[n];
+            Node& node = nodes[n];
+            if (node.slot < 0) {
+                dropNonResident(n);
+                endTest();
+            } else if (node.hot) {
+                if (node.referenced) {
+                    node.referenced = false;
+                } else {
+                    node.hot = false;
+                    hotCount--;
+                }
+            } else if (node.test) {
+                node.test = false;
+                endTest();
+            }
+        }
+    }
+
+    void runTestHand() {
+        while (nonResident > capacity) {
+            int n = handTest;
+            handTest = next[n];
+            Node& node = nodes[n];
+            if (node.slot < 0) {
+                dropNonResident(n);
+                endTest();
+            } else if (!node.hot && node.test) {
+                node.test = false;
+                endTest();
+            }
+        }
+    }
+};
+
+// LRU-K (O'Neil, O'Neil & Weikum): the victim is the page whose K-th most
+// recent reference is oldest; pages with fewer than K references go first,
+// least recently used among them. Times are the process's own reference
+// count. References less than `period` ticks after the previous one are
+// correlated and count as one: they only move `last`, and when the burst is
+// over the page's older history is shifted forward by its length. Every slot
+// keeps its last K uncorrelated reference times in one packed array (K
+// entries per slot, used as a ring) and the shift is a per-slot offset, so a
+// reference is O(log n) for the heap whatever K is. Evicted pages park their
+// history in a ghost table of at most `frames` pages and pick it up again if
+// they come back. A page loaded without being referenced (read ahead) gets no
+// history until its first use; until then it ranks as a page without a K-th
+// reference, last used when it was loaded.
+class LruK {
+public:
+    void configure(int kth, int correlatedPeriod, size_t ghostCapacity) {
+        k = max(1, kth);
+        period = max(0, correlatedPeriod);
+        capacity = ghostCapacity;
+    }
+
+    void tick() { now++; }
+
+    // page was just loaded into slot; referenced is false for read-ahead
+    void insert(int slot, int page, bool referenced) {
+        resident.ensure(slot, k);
+        if (!referenced) {
+            resident.entries[slot] = History();
+            resident.entries[slot].last = now;  // load time, only for the ordering
+            heap.push(slot, key(slot));
+            return;
+        }
+        adopt(slot, page);
+        push(slot);
+        heap.push(slot, key(slot));
+    }
+
+    void touch(int slot, int page) {
+        History& h = resident.entries[slot];
+        if (h.filled == 0) {
+            adopt(slot, page);  // first use of a page read ahead
+            push(slot);
+            heap.update(slot, key(slot));
+            return;
+        }
+        if (now - h.last <= static_cast<uint32_t>(period)) {
+            h.last = now;  // correlated: same burst
+            return;
+        }
+        h.bias += h.last - hist(slot, 0);
+        push(slot);
+        heap.update(slot, key(slot));
+    }
+
+    // Oldest K-th reference among the pages not referenced within the
+    // correlated period; if every page was, the oldest one regardless
+    int victim() {
+        int slot = heap.top();
+        while (slot >= 0 && resident.entries[slot].filled > 0 &&
+               now - resident.entries[slot].last <= static_cast<uint32_t>(period)) {
+            skipped.push_back(slot);
+            heap.erase(slot);
+            slot = heap.top();
+        }
+        if (slot < 0 && !skipped.empty()) slot = skipped.front();
+        for (int s : skipped) heap.push(s, key(s));
+        skipped.clear();
+        return slot;
+    }
+
+    // The page in slot is being evicted: remember its history
+    void evict(int slot, int page) {
+        if (!heap.contains(slot)) return;
+        heap.erase(slot);
+        if (capacity == 0 || resident.entries[slot].filled == 0) return;
+        if (ghosts.size() >= capacity) ghosts.popBack();
+        int node = ghosts.pushFront(page);
+        ghostHistory.ensure(node, k);
+        resident.copyTo(slot, ghostHistory, node, k);
+    }
+
+    void erase(int slot) { heap.erase(slot); }
+
+    void relocate(int from, int to) {
+        if (!heap.contains(from)) return;
+        resident.ensure(to, k);
+        resident.copyTo(from, resident, to, k);
+        heap.relocate(from, to);
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(k);
+        archive(period);
+        archive(capacity);
+        archive(now);
+        heap.transfer(archive);
+        resident.transfer(archive);
+        ghostHistory.transfer(archive);
+        ghosts.transfer(archive);
+    }
+
+private:
+    // last and the ring's head/fill; times are stored minus bias
+    struct History {
+        uint32_t last = 0;
+        uint32_t bias = 0;
+        int head = 0;
+        int filled = 0;
+    };
+
+    // Histories side by side with their K times packed in one array
+    struct HistoryTable {
+        vector<History> entries;
+        vector<uint32_t> times;  // index * k + i -> reference time
+
+        void ensure(int index, int k) {
+            if (static_cast<size_t>(index) >= entries.size()) {
+                entries.resize(index + 1);
+                times.resize((index + 1) * static_cast<size_t>(k));
+            }
+        }
+
+        void copyTo(int from, HistoryTable& other, int to, int k) const {
+            other.entries[to] = entries[from];
+            std::copy(times.begin() + from * static_cast<size_t>(k), times.begin() + (from + 1) * static_cast<size_t>(k),
+                      other.times.begin() + to * static_cast<size_t>(k));
+        }
+
+        template <class Archive>
+        void transfer(Archive& archive) {
+            archive(entries);
+            archive(times);
+        }
+    };
+
+    int k = 1;
+    int period = 0;
+    size_t capacity = 0;
+    uint32_t now = 0;
+    SlotHeap heap;              // keyed on (K-th reference, last uncorrelated reference)
+    HistoryTable resident;      // by slot
+    HistoryTable ghostHistory;  // by ghost node
+    GhostList ghosts;
+    vector<int> skipped;
+
+    // i-th most recent uncorrelated reference (0 = latest), 0 if there is none
+    uint32_t hist(int slot, int i) const {
+        const History& h = resident.entries[slot];
+        if (i >= h.filled) return 0;
+        return resident.times[slot * static_cast<size_t>(k) + (h.head + i) % k] + h.bias;
+    }
+
+    // Picks up the page's history from the ghost table, or starts it empty
+    void adopt(int slot, int page) {
+        int node = ghosts.find(page);
+        if (node != GhostList::NONE) {
+            ghostHistory.copyTo(node, resident, slot, k);
+            ghosts.erase(page);
+        } else {
+            resident.entries[slot] = History();
+        }
+    }
+
+    // Records an uncorrelated reference at now
+    void push(int slot) {
+        History& h = resident.entries[slot];
+        h.head = (h.head + k - 1) % k;
+        resident.times[slot * static_cast<size_t>(k) + h.head] = now - h.bias;
+        h.filled = min(h.filled + 1, k);
+        h.last = now;
+    }
+
+    int64_t key(int slot) const {
+        if (resident.entries[slot].filled == 0) return resident.entries[slot].last;
+        return static_cast<int64_t>(static_cast<uint64_t>(hist(slot, k - 1)) << 32 | hist(slot, 0));
+    }
+};
+
+// Denning's working set W(t, window): the distinct pages among a process's
+// last `window` references, t counting only that process's own references.
+// recent is a ring of the pages referenced in the window, oldest at
+// recent[t % window], and lastUse holds the tick each working-set page was
+// last referenced at, so when a reference slides out of the window its page
+// leaves the set only if it wasn't referenced again since. O(1) per reference,
+// and the working-set size is exact at every tick.
+class WorkingSetWindow {
+public:
+    static const int NONE = -1;
+
+    void configure(int ticks, int sampleEvery) {
+        window = max(1, ticks);
+        every = max(0, sampleEvery);
+    }
+
+    // Adds a reference to page and slides the window past the oldest one.
+    // Returns the page that dropped out of the working set, or NONE.
+    int reference(int page) {
+        int left = NONE;
+        size_t pos = static_cast<size_t>(tick % window);
+        if (tick >= static_cast<uint64_t>(window)) {
+            int old = recent[pos];
+            int expiredAt = static_cast<int>(static_cast<uint32_t>(tick - window));
+            if (old != page && lastUse.find(pageKey(old)) == expiredAt) {
+                lastUse.erase(pageKey(old));
+                left = old;
+            }
+            recent[pos] = page;
+        } else {
+            recent.push_back(page);  // grows to the window size, then wraps
+        }
+        lastUse.set(pageKey(page), static_cast<int>(static_cast<uint32_t>(tick)));
+        tick++;
+
+        size_t now = lastUse.size();
+        if (tick >= static_cast<uint64_t>(window)) {
+            minFull = min(minFull, now);
+            maxFull = max(maxFull, now);
+        }
+        minAll = min(minAll, now);
+        maxAll = max(maxAll, now);
+        if (every && tick % every == 0) timeline.push_back(static_cast<uint32_t>(now));
+        return left;
+    }
+
+    size_t size() const { return lastUse.size(); }
+    bool contains(int page) const { return lastUse.find(pageKey(page)) != PageTable::NOT_FOUND; }
+
+    // Fills a fresh window with `pages`, oldest first and at most the window
+    // size, as references that aren't counted in the statistics
+    void refill(const vector<int>& pages) {
+        for (int page : pages) {
+            recent.push_back(page);
+            lastUse.set(pageKey(page), static_cast<int>(static_cast<uint32_t>(tick)));
+            tick++;
+        }
+    }
+
+    // Smallest/largest size once the window has filled up; a process with
+    // fewer references than the window falls back to all of its ticks
+    size_t minSize() const { return full() ? minFull : minAll; }
+    size_t maxSize() const { return full() ? maxFull : maxAll; }
+    uint64_t ticks() const { return tick; }
+    int sampleEvery() const { return every; }
+    // Size after every sampleEvery()-th tick
+    const vector<uint32_t>& samples() const { return timeline; }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(window);
+        archive(every);
+        archive(tick);
+        archive(recent);
+        lastUse.transfer(archive);
+        archive(minFull);
+        archive(maxFull);
+        archive(minAll);
+        archive(maxAll);
+        archive(timeline);
+    }
+
+private:
+    int window = 1;
+    int every = 0;
+    uint64_t tick = 0;
+    vector<int> recent;
+    PageTable lastUse;  // page -> tick of its last reference (low 32 bits)
+    size_t minFull = numeric_limits<size_t>::max(), maxFull = 0;
+    size_t minAll = numeric_limits<size_t>::max(), maxAll = 0;
+    vector<uint32_t> timeline;
+
+    bool full() const { return tick >= static_cast<uint64_t>(window); }
+};
+
+const int WorkingSetWindow::NONE;
+
+// Victim-selection structures, maintained incrementally on hits and faults so
+// replacePage() never has to scan the resident set. Only the structure for
+// the running algorithm is filled; erase/relocate are no-ops on the others.
+struct EvictionIndex {
+    SlotList order;         // LIFO: insertion order, newest at the back
+    SlotList recency;       // MRU/WS: most recently used at the front
+    WorkingSetWindow window; // WS: pages referenced within the window
+    LruK lruK;              // LRU-X
+    FrequencyHeap lfu;      // LFU
+    LookaheadIndex opt;     // OPT-lookahead-X
+    ClockRing clock;        // CLOCK
+    TwoQueues twoQ;         // 2Q
+    AdaptiveReplacement arc; // ARC
+    ClockPro clockPro;      // CLOCK-Pro
+
+    // Drops a slot without any ghost bookkeeping
+    void erase(int slot) {
+        order.erase(slot);
+        recency.erase(slot);
+        lruK.erase(slot);
+        lfu.erase(slot);
+        opt.erase(slot);
+        clock.erase(slot);
+        twoQ.erase(slot);
+        arc.erase(slot);
+        clockPro.erase(slot);
+    }
+
+    void relocate(int from, int to) {
+        order.relocate(from, to);
+        recency.relocate(from, to);
+        lruK.relocate(from, to);
+        lfu.relocate(from, to);
+        opt.relocate(from, to);
+        clock.relocate(from, to);
+        twoQ.relocate(from, to);
+        arc.relocate(from, to);
+        clockPro.relocate(from, to);
+    }
+
+    // Every structure, filled or not: an unused one is a few empty arrays
+    template <class Archive>
+    void transfer(Archive& archive) {
+        order.transfer(archive);
+        recency.transfer(archive);
+        window.transfer(archive);
+        lruK.transfer(archive);
+        lfu.transfer(archive);
+        opt.transfer(archive);
+        clock.transfer(archive);
+        twoQ.transfer(archive);
+        arc.transfer(archive);
+        clockPro.transfer(archive);
+    }
+};
+
+// Output for metrics and logs: collects text in a 64KB buffer and hands it
+// to stdio in large writes, so nothing flushes per line
+class BufferedWriter {
+public:
+    explicit BufferedWriter(FILE* f) : file(f) { buffer.reserve(CAPACITY); }
+    ~BufferedWriter() { flush(); }
+
+    BufferedWriter& operator<<(const string& text) { return append(text.data(), text.size()); }
+    BufferedWriter& operator<<(const char* text) { return append(text, strlen(text)); }
+    BufferedWriter& operator<<(char c) { return append(&c, 1); }
+
+    template <class T>
+    typename enable_if<is_integral<T>::value, BufferedWriter&>::type operator<<(T value) {
+        return *this << to_string(value);
+    }
+
+    BufferedWriter& operator<<(double value) {
+        char text[32];
+        int n = snprintf(text, sizeof(text), "%.6g", value);
+        return append(text, n);
+    }
+
+    void flush() {
+        if (!buffer.empty()) fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+        fflush(file);
+    }
+
+private:
+    static const size_t CAPACITY = 1 << 16;
+
+    FILE* file;
+    string buffer;
+
+    BufferedWriter& append(const char* text, size_t n) {
+        if (buffer.size() + n > CAPACITY) {
+            fwrite(buffer.data(), 1, buffer.size(), file);
+            buffer.clear();
+        }
+        buffer.append(text, n);
+        return *this;
+    }
+};
+
+const size_t BufferedWriter::CAPACITY;
+
+// Counts of values in power-of-two buckets: bucket 0 holds 0, bucket b
+// holds [2^(b-1), 2^b)
+struct Log2Histogram {
+    static const int BUCKETS = 65;
+    uint64_t counts[BUCKETS] = {};
+
+    void add(uint64_t value) {
+        counts[value ? 64 - __builtin_clzll(value) : 0]++;
+    }
+
+    void merge(const Log2Histogram& other) {
+        for (int b = 0; b < BUCKETS; b++) counts[b] += other.counts[b];
+    }
+
+    static uint64_t lowerBound(int bucket) { return bucket ? 1ULL << (bucket - 1) : 0; }
+};
+
+const int Log2Histogram::BUCKETS;
+
+// What --metrics reports for one process. Each process is only ever touched
+// by the thread simulating it, so these are plain counters; per-policy
+// totals are merged once the run is over. Distances count the process's own
+// references: inter-arrival is the gap between consecutive faults, reuse the
+// gap since the same page was last referenced.
+struct ProcessMetrics {
+    int processID = 0;
+    uint64_t references = 0;
+    uint64_t hits = 0;
+    uint64_t faults = 0;
+    uint64_t evictions = 0;
+    uint64_t dirtyWritebacks = 0;
+    uint64_t prefetches = 0;     // pages read ahead
+    uint64_t prefetchHits = 0;   // of those, referenced before eviction
+    uint64_t diskReads = 0;
+    uint64_t diskWrites = 0;
+    uint64_t seekDistance = 0;  // tracks moved serving this process's disk operations
+    size_t minWorkset = 0;
+    size_t maxWorkset = 0;
+    Log2Histogram faultInterarrival;
+    Log2Histogram reuseDistance;
+    uint64_t lastFault = 0;
+    PageTable lastUse;  // page -> references count at its last use (low 32 bits)
+
+    void recordReference(int pageNumber, bool fault) {
+        references++;
+        uint32_t now = static_cast<uint32_t>(references);
+        uint64_t key = pageKey(pageNumber);
+        int last = lastUse.find(key);
+        if (last != PageTable::NOT_FOUND) reuseDistance.add(now - static_cast<uint32_t>(last));
+        lastUse.set(key, static_cast<int>(now));
+        if (fault) {
+            if (faults > 0) faultInterarrival.add(references - lastFault);
+            lastFault = references;
+            faults++;
+        } else {
+            hits++;
+        }
+    }
+
+    void merge(const ProcessMetrics& other) {
+        references += other.references;
+        hits += other.hits;
+        faults += other.faults;
+        evictions += other.evictions;
+        dirtyWritebacks += other.dirtyWritebacks;
+        prefetches += other.prefetches;
+        prefetchHits += other.prefetchHits;
+        diskReads += other.diskReads;
+        diskWrites += other.diskWrites;
+        seekDistance += other.seekDistance;
+        minWorkset = min(minWorkset, other.minWorkset);
+        maxWorkset = max(maxWorkset, other.maxWorkset);
+        faultInterarrival.merge(other.faultInterarrival);
+        reuseDistance.merge(other.reuseDistance);
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(processID);
+        archive(references);
+        archive(hits);
+        archive(faults);
+        archive(evictions);
+        archive(dirtyWritebacks);
+        archive(prefetches);
+        archive(prefetchHits);
+        archive(diskReads);
+        archive(diskWrites);
+        archive(seekDistance);
+        archive(faultInterarrival.counts);
+        archive(reuseDistance.counts);
+        archive(lastFault);
+        lastUse.transfer(archive);
+    }
+};
+
+// Metrics of one algorithm's run: every process and their merged total
+struct RunMetrics {
+    string algorithm;
+    vector<ProcessMetrics> processes;
+    ProcessMetrics total;
+};
+
+enum ReadAhead { READAHEAD_OFF, READAHEAD_SEQUENTIAL, READAHEAD_STRIDE, READAHEAD_ADAPTIVE };
+
+// A process's read-ahead and dirty-page state. Faults (and first hits on
+// pages read ahead, which would have been faults) feed the stride detector:
+// sequential mode always reads the next `depth` pages, stride mode only
+// once the same page delta has been seen twice in a row, and adaptive mode
+// follows the stride when there is one and sizes its window by how the last
+// read-ahead went, doubling on a hit and halving on a page evicted unused.
+// The trace has no read/write bit, so a reference writes its page when a
+// hash of its trace position falls under writeThreshold, which makes the
+// same references write in every run.
+struct PagingIO {
+    ReadAhead mode = READAHEAD_OFF;
+    int depth = 0;                // most pages read ahead per fault
+    uint64_t writeThreshold = 0;  // out of 2^32, 0 = read-only
+    bool collectWritebacks = false;  // keep evicted dirty pages for the disk
+    int window = 1;               // adaptive: pages read at the next fault
+    int lastMiss = -1;
+    int stride = 0;
+    bool strideRepeated = false;
+    uint64_t prefetches = 0;
+    uint64_t prefetchHits = 0;
+    uint64_t prefetchWasted = 0;
+    vector<int> prefetched;  // pages read ahead at the latest fault
+    vector<int> writebacks;  // dirty pages evicted and not written yet
+
+    bool active() const { return mode != READAHEAD_OFF || writeThreshold; }
+
+    bool writes(size_t refIndex) const {
+        if (!writeThreshold) return false;
+        uint64_t x = refIndex + 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return ((x ^ (x >> 31)) >> 32) < writeThreshold;
+    }
+
+    void observe(int page) {
+        int delta = lastMiss < 0 ? 0 : page - lastMiss;
+        strideRepeated = delta != 0 && delta == stride;
+        stride = delta;
+        lastMiss = page;
+    }
+
+    // Pages to read ahead of a fault just observed, step pages apart
+    int plan(int& step) {
+        switch (mode) {
+        case READAHEAD_SEQUENTIAL:
+            step = 1;
+            return depth;
+        case READAHEAD_STRIDE:
+            step = stride;
+            return strideRepeated ? depth : 0;
+        case READAHEAD_ADAPTIVE:
+            step = strideRepeated ? stride : 1;
+            if (window == 0 && strideRepeated) window = 1;
+            return window;
+        default:
+            return 0;
+        }
+    }
+
+    void used() {
+        prefetchHits++;
+        if (mode == READAHEAD_ADAPTIVE) window = min(max(window * 2, 1), depth);
+    }
+
+    void wasted() {
+        prefetchWasted++;
+        if (mode == READAHEAD_ADAPTIVE) window /= 2;
+    }
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(mode);
+        archive(depth);
+        archive(writeThreshold);
+        archive(collectWritebacks);
+        archive(window);
+        archive(lastMiss);
+        archive(stride);
+        archive(strideRepeated);
+        archive(prefetches);
+        archive(prefetchHits);
+        archive(prefetchWasted);
+        archive(prefetched);
+        archive(writebacks);
+    }
+};
+
+struct Process {
+    int id;
+    int size;
+    bool isFinished = false;
+    int faultCount = 0;
+    size_t minWorkset = std::numeric_limits<size_t>::max();  // lowered by the first sample
+    size_t maxWorkset = 0;
+    ResidentSet pages;
+    PageTable pageTable; // pageNumber -> slot in pages, kept in sync with the resident set
+    EvictionIndex eviction;
+    ProcessMetrics* metrics = nullptr; // set when --metrics is on
+    PagingIO io;
+
+    Process(int processID, int frames) : id(processID), size(frames) {
+        pageTable.reserve(frames > 0 ? frames : 0);
+    }
+
+    // Everything but metrics; without the eviction index when it is not
+    // wanted, which a reader still has to get past
+    template <class Archive>
+    void transfer(Archive& archive, bool withEviction) {
+        archive(id);
+        archive(size);
+        archive(isFinished);
+        archive(faultCount);
+        archive(minWorkset);
+        archive(maxWorkset);
+        pages.transfer(archive);
+        pageTable.transfer(archive);
+        if (withEviction) {
+            eviction.transfer(archive);
+        } else {
+            EvictionIndex skipped;
+            skipped.transfer(archive);
+        }
+        io.transfer(archive);
+    }
+};
+struct Frame {
+    int id;
+    int pageNumber;
+    int processID;
+};
+
+struct DPT {
+    int processID;
+    int pageNumber;
+    int time;
+};
+
+// Binary trace file: a TraceHeader followed by `count` packed DPT records.
+// The records are laid out exactly like DPT so the mapped file can be walked
+// in place without copying anything into dptEntries.
+const char TRACE_MAGIC[8] = {'D', 'P', 'T', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t count;
+};
+
+// Read-only window over the references, either backed by an mmap'd binary
+// trace or by dptEntries when a text trace was loaded.
+struct TraceView {
+    const DPT* entries = nullptr;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const DPT& operator[](size_t i) const { return entries[i]; }
+    const DPT* begin() const { return entries; }
+    const DPT* end() const { return entries + count; }
+};
+
+struct MappedTrace {
+    void* base = MAP_FAILED;
+    size_t length = 0;
+
+    ~MappedTrace() {
+        if (base != MAP_FAILED) munmap(base, length);
+    }
+};
+
+// Maps a process id to its index in a process list, -1 if unknown
+struct ProcessIndex {
+    vector<int> slots;
+
+    explicit ProcessIndex(const vector<Process>& procs) {
+        for (size_t i = 0; i < procs.size(); i++) {
+            int id = procs[i].id;
+            if (id < 0) continue;
+            if (static_cast<size_t>(id) >= slots.size()) slots.resize(id + 1, -1);
+            slots[id] = static_cast<int>(i);
+        }
+    }
+
+    int operator()(int id) const {
+        return id >= 0 && static_cast<size_t>(id) < slots.size() ? slots[id] : -1;
+    }
+};
+
+// The trace split by process: positions[offsets[i] .. offsets[i + 1]) are the
+// trace positions of processes[i]'s references, in trace order
+struct TracePartition {
+    vector<size_t> offsets;
+    vector<uint32_t> positions;
+
+    size_t count(size_t proc) const { return offsets[proc + 1] - offsets[proc]; }
+    const uint32_t* begin(size_t proc) const { return positions.data() + offsets[proc]; }
+    const uint32_t* end(size_t proc) const { return positions.data() + offsets[proc + 1]; }
+};
+
+// Tunables of one simulation run
+struct SimParams {
+    int x;         // OPT lookahead window, from the config
+    int k;         // LRU-X: which most recent access pages are ranked by
+    int correlatedPeriod;  // LRU-X: references this many ticks apart or closer count as one
+    int wsWindow;  // WS: working-set window in ticks (the process's own references)
+    int wsSampleEvery;  // WS: record the working-set size every N ticks, 0 = never
+    int frames;    // frames per process, 0 = each process's size from the config
+    ReadAhead readAhead;
+    int readAheadPages;  // read-ahead depth (adaptive: largest window)
+    double writeRatio;   // share of references that write their page
+    int ioBatch;         // disk requests one arm visit may serve together
+
+    template <class Archive>
+    void transfer(Archive& archive) {
+        archive(x);
+        archive(k);
+        archive(correlatedPeriod);
+        archive(wsWindow);
+        archive(wsSampleEvery);
+        archive(frames);
+        archive(readAhead);
+        archive(readAheadPages);
+        archive(writeRatio);
+        archive(ioBatch);
+    }
+};
+
+// Command line switches
+struct Options {
+    bool parallel = false;  // --parallel: simulate the processes of a run on all cores
+    bool diskTiming = false; // --disk: time faults against a simulated disk
+    vector<string> diskSchedulers;  // --disk-sched, empty = FIFO
+    size_t poolFrames = 0;      // --pool: GLOBAL frame pool size, 0 = sum of the config's
+    size_t occupancyEvery = 0;  // --occupancy-every: GLOBAL sampling interval, 0 = 20 samples
+    vector<string> globalPolicies;  // --global-policy, empty = LRU, CLOCK and LFU
+    string metricsFormat;   // --metrics: "json" or "csv" instead of the text report
+    bool verbose = false;   // --verbose: log every disk operation to stderr
+    bool stream = false;    // --stream: simulate the trace as it is read (implied by "-" for stdin)
+    size_t mrcFrames = 0;   // --mrc-frames: largest frame count on the MRC, 0 = every one
+    double shardsRate = 0;  // --shards: SHARDS sampling rate for MRC, 0 = exact
+    size_t shardsMax = 0;   // --shards-max: cap on sampled pages per process, 0 = none
+    // SWEEP ranges, empty = the single default value
+    vector<int> sweepX, sweepK, sweepWindow, sweepFrames;
+    int correlatedPeriod = 0;  // --crp: LRU-X correlated reference period
+    int wsTimeline = 0;     // --ws-timeline: sample WS working-set sizes every N references
+    ReadAhead readAhead = READAHEAD_OFF;  // --readahead
+    int readAheadPages = 4;  // --readahead-pages
+    double writeRatio = 0;   // --write-ratio
+    int ioBatch = 1;         // --io-batch: 1 = no coalescing
+    string checkpointPath;   // --checkpoint: snapshot file to write
+    size_t checkpointAt = SIZE_MAX;  // --checkpoint-at: trace position to take it at
+    string resumeFrom;       // --resume: snapshot to continue from
+    vector<string> sweepAlgorithms;  // --algorithms, empty = all
+};
+
+// Virtual time, in microseconds
+typedef uint64_t SimTime;
+
+enum DiskOpType : uint8_t { DISK_READ, DISK_WRITE, DISK_PREFETCH };
+
+// Plain 32-byte record so requests can be copied through the disk queues
+// without allocating
+struct DiskOperation {
+    int32_t processID;
+    int32_t pageNumber;
+    int32_t diskAddress;  // swap slot
+    int32_t track;
+    int32_t seekTime;     // tracks travelled to serve it
+    DiskOpType type;
+    SimTime queuedAt;
+};
+
+
+
+// Configuration and trace shared read-only by every Simulator
+vector<Process> processes; // as read from the config, no pages resident
+vector<DPT> dptEntries;
+TraceView trace;
+MappedTrace mappedTrace;
+bool traceLoaded = false;
+vector<uint32_t> nextUse; // trace position -> distance to the same page's next reference
+TraceView nextUseTrace;   // trace nextUse was built for
+TracePartition processTraces; // trace split by process for --parallel
+
+int g_nX, g_nPageSize;
+string algorithm;
+const vector<string> allAlgorithms = {"LIFO", "MRU", "LRU-X", "LFU", "OPT-lookahead-X", "WS",
+                                     "CLOCK", "CLOCK-Pro", "2Q", "ARC"};
+
+// Void Declarations
+void readFile(const string& filepath);
+void loadTrace(const string& filepath);
+void loadTextTrace(const string& filepath);
+void loadBinaryTrace(const string& filepath);
+void convertTrace(const string& textPath, const string& binaryPath);
+void generateRandomTrace();
+void buildNextUseIndex();
+template <class Policy> bool accessPage(Process& process, int pageNumber, int currentTime, size_t refIndex);
+template <class Policy> void pageFaultHandler(Process& process, int pageNumber, int currentTime, size_t refIndex);
+void buildPartition();
+void analyzeMissRatio(const Options& options);
+void simulate(const string& algorithm, const Options& options);
+void simulateAll(const vector<string>& algorithms, const Options& options);
+template <class Policy> void replacePage(Process& process, size_t refIndex);
+template <class Policy> void removePageAt(Process& process, size_t idx);
+
+void readFile(const string& filepath) {
+    ifstream file(filepath);
+    if (!file) {
+        cerr << "Unable to open file!" << endl;
+        exit(1);
+    }
+    file >> g_nPageSize >> g_nX;
+    int id, size;
+    while (file >> id >> size) {
+        processes.push_back(Process(id, size));
+    }
+}
+
+static bool isBinaryTrace(const string& filepath) {
+    ifstream file(filepath, ios::binary);
+    char magic[sizeof(TRACE_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+}
+
+void loadTrace(const string& filepath) {
+    if (isBinaryTrace(filepath)) {
+        loadBinaryTrace(filepath);
+    } else {
+        loadTextTrace(filepath);
+    }
+    traceLoaded = true;
+}
+
+// Without a trace file every process gets 100 rand() % 50 references
+void generateRandomTrace() {
+    dptEntries.clear();
+    for (auto& process : processes) {
+        for (int time = 0; time < 100; ++time) {  // Simulate time slices
+            int pageNum = rand() % 50;  // Random page access
+            dptEntries.push_back({process.id, pageNum, time});
+        }
+    }
+    trace.entries = dptEntries.data();
+    trace.count = dptEntries.size();
+}
+
+// One backward sweep over the trace records, for every reference, where the
+// same process touches the same page next. OPT-lookahead-X reads its future
+// from here instead of rescanning the remaining trace on every fault.
+void buildNextUseIndex() {
+    if (nextUseTrace.entries == trace.entries && nextUseTrace.count == trace.count) return;
+    if (trace.size() >= static_cast<size_t>(INT_MAX)) {
+        cerr << "Trace too long for OPT-lookahead-X!" << endl;
+        exit(1);
+    }
+    nextUse.assign(trace.size(), LookaheadIndex::NEVER);
+    PageTable lastSeen; // (processID, pageNumber) -> nearest later position
+    for (size_t i = trace.size(); i-- > 0;) {
+        uint64_t key = frameKey(trace[i].processID, trace[i].pageNumber);
+        int later = lastSeen.find(key);
+        if (later != PageTable::NOT_FOUND) nextUse[i] = static_cast<uint32_t>(later - i);
+        lastSeen.set(key, static_cast<int>(i));
+    }
+    nextUseTrace = trace;
+}
+
+// Counting sort of trace positions by owning process, two passes over the
+// trace. Processes are independent under local replacement, so each slice
+// can be simulated on its own.
+void buildPartition() {
+    if (trace.size() >= static_cast<size_t>(UINT32_MAX)) {
+        cerr << "Trace too long for --parallel!" << endl;
+        exit(1);
+    }
+    ProcessIndex slotOf(processes);
+
+    processTraces.offsets.assign(processes.size() + 1, 0);
+    for (const DPT& line : trace) {
+        int s = slotOf(line.processID);
+        if (s >= 0) processTraces.offsets[s + 1]++;
+    }
+    for (size_t i = 0; i < processes.size(); i++) {
+        processTraces.offsets[i + 1] += processTraces.offsets[i];
+    }
+    processTraces.positions.resize(processTraces.offsets.back());
+    vector<size_t> cursor(processTraces.offsets.begin(), processTraces.offsets.end() - 1);
+    for (size_t i = 0; i < trace.size(); i++) {
+        int s = slotOf(trace[i].processID);
+        if (s >= 0) processTraces.positions[cursor[s]++] = static_cast<uint32_t>(i);
+    }
+}
+
+// Text traces hold one "processID pageNumber time" reference per line. They are
+// fine for small hand-written inputs; large traces should go through
+// convertTrace() once and be loaded with loadBinaryTrace().
+void loadTextTrace(const string& filepath) {
+    ifstream file(filepath);
+    if (!file) {
+        cerr << "Unable to open trace file!" << endl;
+        exit(1);
+    }
+    DPT dpt;
+    while (file >> dpt.processID >> dpt.pageNumber >> dpt.time) {
+        dptEntries.push_back(dpt);
+    }
+    trace.entries = dptEntries.data();
+    trace.count = dptEntries.size();
+}
+
+void loadBinaryTrace(const string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Unable to open trace file!" << endl;
+        exit(1);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TraceHeader)) {
+        cerr << "Trace file is truncated!" << endl;
+        exit(1);
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        cerr << "Unable to map trace file!" << endl;
+        exit(1);
+    }
+    // References are consumed front to back, let the kernel read ahead and drop behind
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    const TraceHeader* header = static_cast<const TraceHeader*>(base);
+    if (header->version != TRACE_VERSION || header->recordSize != sizeof(DPT) ||
+        header->count > (length - sizeof(TraceHeader)) / sizeof(DPT)) {
+        munmap(base, length);
+        cerr << "Unsupported or corrupt trace file!" << endl;
+        exit(1);
+    }
+    mappedTrace.base = base;
+    mappedTrace.length = length;
+    trace.entries = reinterpret_cast<const DPT*>(static_cast<const char*>(base) + sizeof(TraceHeader));
+    trace.count = static_cast<size_t>(header->count);
+}
+
+// Streams a text trace into the binary format in fixed-size chunks, so even
+// huge text traces are converted without holding them in memory.
+void convertTrace(const string& textPath, const string& binaryPath) {
+    ifstream in(textPath);
+    if (!in) {
+        cerr << "Unable to open trace file!" << endl;
+        exit(1);
+    }
+    FILE* out = fopen(binaryPath.c_str(), "wb");
+    if (!out) {
+        cerr << "Unable to create " << binaryPath << endl;
+        exit(1);
+    }
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(DPT);
+    header.count = 0;
+    fwrite(&header, sizeof(header), 1, out); // count is patched once we know it
+
+    vector<DPT> chunk;
+    chunk.reserve(1 << 16);
+    DPT dpt;
+    while (in >> dpt.processID >> dpt.pageNumber >> dpt.time) {
+        chunk.push_back(dpt);
+        if (chunk.size() == chunk.capacity()) {
+            fwrite(chunk.data(), sizeof(DPT), chunk.size(), out);
+            header.count += chunk.size();
+            chunk.clear();
+        }
+    }
+    fwrite(chunk.data(), sizeof(DPT), chunk.size(), out);
+    header.count += chunk.size();
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    if (fclose(out) != 0) {
+        cerr << "Failed writing " << binaryPath << endl;
+        exit(1);
+    }
+    cout << "Converted " << header.count << " references to " << binaryPath << endl;
+}
+
+
+
+
+
+// Replacement policies. Each one keeps its victim-selection structure in
+// Process::eviction up to date through static hooks, and the simulation
+// functions below are templated on the policy, so the hot path is compiled
+// once per policy with the hooks inlined and no dispatch on the name.
+// PolicyBase supplies the defaults a policy does not override.
+struct PolicyBase {
+    static const bool needsNextUse = false;
+    // Which SimParams the policy reads; a sweep doesn't vary the others
+    static const bool usesX = false;
+    static const bool usesK = false;
+    static const bool usesWindow = false;
+
+    static void configure(Process&, const SimParams&) {}
+    // Every reference, before the page is looked up
+    static void onReference(Process&, int) {}
+    // After every reference: the size the workset statistics track
+    static void recordWorkset(Process& p) {
+        p.minWorkset = min(p.minWorkset, p.pages.size());
+        p.maxWorkset = max(p.maxWorkset, p.pages.size());
+    }
+    // A miss on pageNumber, before the victim (if any) is chosen, and the
+    // page going into slot. ref is its trace position, or NO_REFERENCE for a
+    // page that isn't being referenced (read ahead): the policy mustn't
+    // count that as a use.
+    static void onFault(Process&, int, size_t) {}
+    static void onInsert(Process&, int, size_t) {}
+    static bool referenced(size_t ref) { return ref != LookaheadIndex::NO_REFERENCE; }
+    static void onHit(Process&, int, size_t) {}
+    // A streamed trace just showed the page in slot is used again at position next
+    static void onNextUse(Process&, int, size_t) {}
+    // Resumed from another policy's snapshot: every slot went through
+    // onInsert(), oldest access first, in the order given
+    static void restore(Process&, const vector<int>&) {}
+    // Default cleanup works for any policy: untracked structures are no-ops
+    static void erase(Process& process, int slot) { process.eviction.erase(slot); }
+    static void relocate(Process& process, int from, int to) { process.eviction.relocate(from, to); }
+};
+
+struct LIFOPolicy : PolicyBase {
+    static const char* name() { return "LIFO"; }
+    static void onInsert(Process& p, int slot, size_t) { p.eviction.order.pushBack(slot); }
+    static int victim(Process& p, size_t) { return p.eviction.order.back(); }  // Last page loaded
+    static void erase(Process& p, int slot) { p.eviction.order.erase(slot); }
+    static void relocate(Process& p, int from, int to) { p.eviction.order.relocate(from, to); }
+};
+
+struct MRUPolicy : PolicyBase {
+    static const char* name() { return "MRU"; }
+    static void onInsert(Process& p, int slot, size_t) { p.eviction.recency.pushFront(slot); }
+    static void onHit(Process& p, int slot, size_t) { p.eviction.recency.moveToFront(slot); }
+    static int victim(Process& p, size_t) { return p.eviction.recency.front(); }  // Most recently used
+    static void erase(Process& p, int slot) { p.eviction.recency.erase(slot); }
+    static void relocate(Process& p, int from, int to) { p.eviction.recency.relocate(from, to); }
+};
+
+// LRU-K with K = params.k
+struct LRUXPolicy : PolicyBase {
+    static const bool usesK = true;
+    static const char* name() { return "LRU-X"; }
+    static void configure(Process& p, const SimParams& params) {
+        p.eviction.lruK.configure(params.k, params.correlatedPeriod, p.size > 0 ? p.size : 0);
+    }
+    static void onReference(Process& p, int) { p.eviction.lruK.tick(); }
+    static void onInsert(Process& p, int slot, size_t ref) {
+        p.eviction.lruK.insert(slot, p.pages.pageNumber(slot), referenced(ref));
+    }
+    static void onHit(Process& p, int slot, size_t) { p.eviction.lruK.touch(slot, p.pages.pageNumber(slot)); }
+    static int victim(Process& p, size_t) { return p.eviction.lruK.victim(); }  // Oldest kth access
+    static void erase(Process& p, int slot) { p.eviction.lruK.evict(slot, p.pages.pageNumber(slot)); }
+    static void relocate(Process& p, int from, int to) { p.eviction.lruK.relocate(from, to); }
+};
+
+struct LFUPolicy : PolicyBase {
+    static const char* name() { return "LFU"; }
+    static void onInsert(Process& p, int slot, size_t ref) { p.eviction.lfu.insert(slot, referenced(ref) ? 1 : 0); }
+    static void onHit(Process& p, int slot, size_t) { p.eviction.lfu.touch(slot); }
+    static int victim(Process& p, size_t) { return p.eviction.lfu.victim(); }  // Least frequent, first loaded among ties
+    static void erase(Process& p, int slot) { p.eviction.lfu.erase(slot); }
+    static void relocate(Process& p, int from, int to) { p.eviction.lfu.relocate(from, to); }
+    // The counts were kept in the resident set all along; the load order
+    // wasn't, so ties go oldest access first
+    static void restore(Process& p, const vector<int>& slots) {
+        p.eviction.lfu = FrequencyHeap();
+        for (int slot : slots) p.eviction.lfu.insert(slot, p.pages.frequency(slot));
+    }
+};
+
+struct OPTPolicy : PolicyBase {
+    static const bool needsNextUse = true;
+    static const bool usesX = true;
+
+    static const char* name() { return "OPT-lookahead-X"; }
+    static void configure(Process& p, const SimParams& params) {
+        p.eviction.opt.nextUse = nextUse.data();
+        p.eviction.opt.window = params.x;
+    }
+    static void onInsert(Process& p, int slot, size_t ref) { p.eviction.opt.place(slot, ref); }
+    static void onHit(Process& p, int slot, size_t ref) { p.eviction.opt.place(slot, ref); }
+    // Farthest next use within the window
+    static int victim(Process& p, size_t ref) { return p.eviction.opt.victim(ref); }
+    static void erase(Process& p, int slot) { p.eviction.opt.erase(slot); }
+    static void relocate(Process& p, int from, int to) { p.eviction.opt.relocate(from, to); }
+    static void onNextUse(Process& p, int slot, size_t next) { p.eviction.opt.learn(slot, next); }
+};
+
+// Keeps exactly the working set resident: a page is evicted the moment its
+// last reference slides out of the window. When the working set outgrows the
+// process's frames the least recently used page goes, as before.
+struct WSPolicy : PolicyBase {
+    static const bool usesWindow = true;
+    static const char* name() { return "WS"; }
+    static void configure(Process& p, const SimParams& params) {
+        p.eviction.window.configure(params.wsWindow, params.wsSampleEvery);
+    }
+    static void onReference(Process& p, int pageNumber) {
+        int left = p.eviction.window.reference(pageNumber);
+        if (left == WorkingSetWindow::NONE) return;
+        int slot = p.pageTable.find(pageKey(left));
+        if (slot != PageTable::NOT_FOUND) {
+            removePageAt<WSPolicy>(p, slot);
+            if (p.metrics) p.metrics->evictions++;
+        }
+    }
+    static void recordWorkset(Process& p) {
+        p.minWorkset = p.eviction.window.minSize();
+        p.maxWorkset = p.eviction.window.maxSize();
+    }
+    static void onInsert(Process& p, int slot, size_t) { p.eviction.recency.pushFront(slot); }
+    static void onHit(Process& p, int slot, size_t) { p.eviction.recency.moveToFront(slot); }
+    // The least recently used page is the first to fall out of the window
+    static int victim(Process& p, size_t) { return p.eviction.recency.back(); }
+    static void erase(Process& p, int slot) { p.eviction.recency.erase(slot); }
+    static void relocate(Process& p, int from, int to) { p.eviction.recency.relocate(from, to); }
+};
+
+struct ClockPolicy : PolicyBase {
+    static const char* name() { return "CLOCK"; }
+    static void onInsert(Process& p, int slot, size_t ref) { p.eviction.clock.insert(slot, referenced(ref)); }
+    static void onHit(Process& p, int slot, size_t) { p.eviction.clock.touch(slot); }
+    static int victim(Process& p, size_t) { return p.eviction.clock.victim(); }
+    static void erase(Process& p, int slot) { p.eviction.clock.erase(slot); }
+    static void relocate(Process& p, int from, int to) { p.eviction.clock.relocate(from, to); }
+};
+
+struct ClockProPolicy : PolicyBase {
+    static const char* name() { return "CLOCK-Pro"; }
+    static void configure(Process& p, const SimParams&) { p.eviction.clockPro.configure(p.size); }
+    static void onFault(Process& p, int page, size_t ref) { p.eviction.clockPro.miss(page, referenced(ref)); }
+    static void onInsert(Process& p, int slot, size_t ref) {
+        p.eviction.clockPro.insert(slot, p.pages.pageNumber(slot), referenced(ref));
+    }
+    static void onHit(Process& p, int slot, size_t) { p.eviction.clockPro.touch(slot); }
+    static int victim(Process& p, size_t) { return p.eviction.clockPro.victim(); }
+    static void erase(Process& p, int slot) { p.eviction.clockPro.evict(slot); }
+    static void relocate(Process& p, int from, int to) { p.eviction.clockPro.relocate(from, to); }
+};
+
+struct TwoQPolicy : PolicyBase {
+    static const char* name() { return "2Q"; }
+    static void configure(Process& p, const SimParams&) { p.eviction.twoQ.capacity = p.size; }
+    static void onFault(Process& p, int page, size_t ref) { p.eviction.twoQ.miss(page, referenced(ref)); }
+    static void onInsert(Process& p, int slot, size_t ref) {
+        p.eviction.twoQ.insert(slot, p.pages.pageNumber(slot), referenced(ref));
+    }
+    static void onHit(Process& p, int slot, size_t) { p.eviction.twoQ.touch(slot); }
+    static int victim(Process& p, size_t) { return p.eviction.twoQ.victim(); }
+    static void erase(Process& p, int slot) { p.eviction.twoQ.evict(slot, p.pages.pageNumber(slot)); }
+    static void relocate(Process& p, int from, int to) { p.eviction.twoQ.relocate(from, to); }
+};
+
+struct ARCPolicy : PolicyBase {
+    static const char* name() { return "ARC"; }
+    static void configure(Process& p, const SimParams&) { p.eviction.arc.capacity = p.size; }
+    static void onFault(Process& p, int page, size_t ref) { p.eviction.arc.miss(page, p.pages.size(), referenced(ref)); }
+    static void onInsert(Process& p, int slot, size_t ref) {
+        p.eviction.arc.insert(slot, p.pages.pageNumber(slot), referenced(ref));
+    }
+    static void onHit(Process& p, int slot, size_t) { p.eviction.arc.touch(slot); }
+    static int victim(Process& p, size_t) { return p.eviction.arc.victim(p.pages.size()); }
+    static void erase(Process& p, int slot) { p.eviction.arc.evict(slot, p.pages.pageNumber(slot)); }
+    static void relocate(Process& p, int from, int to) { p.eviction.arc.relocate(from, to); }
+};
+
+// Calls f(Policy()) for the policy called `algorithm`. This is the only place
+// a policy name is compared; returns false for an unknown name.
+template <class F>
+bool dispatchPolicy(const string& algorithm, F f) {
+    if (algorithm == LIFOPolicy::name()) f(LIFOPolicy());
+    else if (algorithm == MRUPolicy::name()) f(MRUPolicy());
+    else if (algorithm == LRUXPolicy::name()) f(LRUXPolicy());
+    else if (algorithm == LFUPolicy::name()) f(LFUPolicy());
+    else if (algorithm == OPTPolicy::name()) f(OPTPolicy());
+    else if (algorithm == WSPolicy::name()) f(WSPolicy());
+    else if (algorithm == ClockPolicy::name()) f(ClockPolicy());
+    else if (algorithm == ClockProPolicy::name()) f(ClockProPolicy());
+    else if (algorithm == TwoQPolicy::name()) f(TwoQPolicy());
+    else if (algorithm == ARCPolicy::name()) f(ARCPolicy());
+    else return false;
+    return true;
+}
+
+// Drops the page in slot idx by moving the last page into its place, so the
+// page table and eviction structure only have to be patched for the one page
+// that moved
+template <class Policy>
+void removePageAt(Process& process, size_t idx) {
+    int last = static_cast<int>(process.pages.size()) - 1;
+    if (int flags = process.pages.flags(static_cast<int>(idx))) {
+        if (flags & ResidentSet::DIRTY) {
+            if (process.metrics) process.metrics->dirtyWritebacks++;
+            if (process.io.collectWritebacks) process.io.writebacks.push_back(process.pages.pageNumber(idx));
+        }
+        if (flags & ResidentSet::PREFETCHED) process.io.wasted();
+    }
+    process.pageTable.erase(pageKey(process.pages.pageNumber(idx)));
+    Policy::erase(process, static_cast<int>(idx));
+    process.pages.removeAt(static_cast<int>(idx));
+    if (static_cast<int>(idx) != last) {
+        process.pageTable.set(pageKey(process.pages.pageNumber(idx)), static_cast<int>(idx));
+        Policy::relocate(process, last, static_cast<int>(idx));
+    }
+}
+
+template <class Policy>
+void replacePage(Process& process, size_t refIndex) {
+    if (process.pages.empty()) return; // No pages to replace
+
+    int victim = Policy::victim(process, refIndex);
+    if (victim >= 0) {
+        removePageAt<Policy>(process, victim);
+        if (process.metrics) process.metrics->evictions++;
+    }
+}
+
+// Brings a page in, evicting one first if the process's frames are full.
+// refIndex is the faulting reference's position; a page read ahead isn't
+// referenced there, so the policy is told NO_REFERENCE about it instead.
+template <class Policy>
+void loadPage(Process& process, int pageNumber, int currentTime, size_t refIndex, int flags) {
+    size_t ref = flags & ResidentSet::PREFETCHED ? LookaheadIndex::NO_REFERENCE : refIndex;
+    Policy::onFault(process, pageNumber, ref);
+    if (process.pages.size() >= static_cast<size_t>(process.size)) {
+        replacePage<Policy>(process, refIndex);
+    }
+    // Add the new page
+    int slot = process.pages.push(pageNumber, currentTime, flags);
+    process.pageTable.set(pageKey(pageNumber), slot);
+    Policy::onInsert(process, slot, ref);
+}
+
+// Loads what the process's read-ahead asks for around a fault on pageNumber.
+// The pages go in before the faulting one, so none of them can push it out,
+// and never more than the frames can hold next to it.
+template <class Policy>
+void readAhead(Process& process, int pageNumber, int currentTime, size_t refIndex) {
+    PagingIO& io = process.io;
+    io.prefetched.clear();
+    io.observe(pageNumber);
+    int step = 1;
+    int count = min(io.plan(step), process.size - 1);
+    for (int i = 1; i <= count; i++) {
+        int64_t page = pageNumber + static_cast<int64_t>(i) * step;
+        if (page < 0 || page > INT_MAX) break;
+        int target = static_cast<int>(page);
+        if (process.pageTable.find(pageKey(target)) != PageTable::NOT_FOUND) continue;
+        loadPage<Policy>(process, target, currentTime, refIndex, ResidentSet::PREFETCHED);
+        io.prefetches++;
+        io.prefetched.push_back(target);
+        if (process.metrics) process.metrics->prefetches++;
+    }
+}
+
+template <class Policy>
+void pageFaultHandler(Process& process, int pageNumber, int currentTime, size_t refIndex) {
+    int flags = process.io.writes(refIndex) ? ResidentSet::DIRTY : 0;
+    if (process.io.mode != READAHEAD_OFF) readAhead<Policy>(process, pageNumber, currentTime, refIndex);
+    loadPage<Policy>(process, pageNumber, currentTime, refIndex, flags);
+    process.faultCount++;
+}
+
+// A hit on a page with state bits: the first use of a page read ahead is a
+// fault it saved, and a write dirties the page
+inline void touchState(Process& process, int slot, int pageNumber, size_t refIndex) {
+    int flags = process.pages.flags(slot);
+    if (flags & ResidentSet::PREFETCHED) {
+        flags &= ~ResidentSet::PREFETCHED;
+        process.io.observe(pageNumber);
+        process.io.used();
+        if (process.metrics) process.metrics->prefetchHits++;
+    }
+    if (process.io.writes(refIndex)) flags |= ResidentSet::DIRTY;
+    process.pages.setFlags(slot, flags);
+}
+
+// Returns true if the reference faulted
+template <class Policy>
+bool accessPage(Process& process, int pageNumber, int currentTime, size_t refIndex) {
+    Policy::onReference(process, pageNumber);
+    int slot = process.pageTable.find(pageKey(pageNumber));
+    bool fault = slot == PageTable::NOT_FOUND;
+    if (process.metrics) process.metrics->recordReference(pageNumber, fault);
+
+    if (fault) {
+        pageFaultHandler<Policy>(process, pageNumber, currentTime, refIndex);
+    } else {
+        process.pages.touch(slot, currentTime);
+        if (process.io.active()) touchState(process, slot, pageNumber, refIndex);
+        Policy::onHit(process, slot, refIndex);
+    }
+    Policy::recordWorkset(process);
+    return fault;
+}
+
+// Simulated durations of the fault path and the disk, in microseconds
+struct DiskTiming {
+    SimTime perReference = 1;    // CPU time of one memory reference
+    SimTime faultService = 50;   // trap and handler work before the read is queued
+    SimTime seekPerTrack = 20;   // head movement per track crossed
+    SimTime rotation = 4000;     // average rotational latency
+    SimTime transfer = 100;      // moving one page
+    int pagesPerTrack = 64;
+    int maxBatch = 1;            // requests served in one arm visit
+};
+
+enum EventType { EVENT_RUN, EVENT_IO_REQUEST, EVENT_IO_DONE };
+
+struct Event {
+    SimTime time;
+    uint64_t seq;
+    EventType type;
+    int target;  // process index for RUN/IO_REQUEST
+};
+
+// Discrete-event core: pending events ordered by virtual time (FIFO among
+// equal times). Popping an event advances the clock to it, so nothing ever
+// waits in wall-clock time.
+class EventQueue {
+public:
+    SimTime now() const { return clock; }
+    bool empty() const { return events.empty(); }
+
+    void schedule(SimTime time, EventType type, int target) {
+        Event ev = {time, seq++, type, target};
+        events.push(ev);
+    }
+
+    Event next() {
+        Event ev = events.top();
+        events.pop();
+        clock = ev.time;
+        return ev;
+    }
+
+private:
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.time != b.time ? a.time > b.time : a.seq > b.seq;
+        }
+    };
+
+    priority_queue<Event, vector<Event>, Later> events;
+    uint64_t seq = 0;
+    SimTime clock = 0;
+};
+
+struct DiskStats {
+    uint64_t operations = 0;
+    uint64_t prefetches = 0;  // of the operations, reads ahead
+    uint64_t writes = 0;      // of the operations, dirty page writebacks
+    uint64_t batches = 0;     // arm visits, each paying one rotation
+    uint64_t tracksMoved = 0;
+    SimTime busyTime = 0;   // total simulated I/O time
+    SimTime queueTime = 0;  // time requests waited behind others
+};
+
+// Pending disk requests and the order the arm serves them in. SSTF and the
+// sweeps keep the requests in a multimap on track (FIFO among equal tracks),
+// so picking the next one is O(log n). The sweeping policies treat the
+// highest track requested so far as the end of the swap area. The seek
+// distance of a dispatch includes any trip to the end of the disk and, for
+// C-SCAN/C-LOOK, the return sweep.
+class DiskScheduler {
+public:
+    enum Policy { FIFO, SSTF, SCAN, CSCAN, LOOK, CLOOK };
+
+    static const char* name(Policy policy) {
+        static const char* names[] = {"FIFO", "SSTF", "SCAN", "C-SCAN", "LOOK", "C-LOOK"};
+        return names[policy];
+    }
+
+    static bool parse(const string& text, Policy& policy) {
+        for (int p = FIFO; p <= CLOOK; p++) {
+            if (text == name(static_cast<Policy>(p))) {
+                policy = static_cast<Policy>(p);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    explicit DiskScheduler(Policy p) : policy(p) {}
+
+    bool empty() const { return policy == FIFO ? fifo.empty() : byTrack.empty(); }
+
+    void push(const DiskOperation& op) {
+        lastTrack = max(lastTrack, op.track);
+        if (policy == FIFO) {
+            fifo.push_back(op);
+        } else {
+            byTrack.insert(make_pair(op.track, op));
+        }
+    }
+
+    // Removes the next request to serve with the arm at head, moves the
+    // arm there and returns the tracks travelled in seekDistance
+    DiskOperation pop(int& head, int& seekDistance) {
+        DiskOperation op;
+        if (policy == FIFO) {
+            op = fifo.front();
+            fifo.pop_front();
+            seekDistance = abs(op.track - head);
+            head = op.track;
+            return op;
+        }
+
+        Queue::iterator it;
+        seekDistance = -1;
+        switch (policy) {
+        case SSTF: {
+            it = byTrack.lower_bound(head);
+            if (it == byTrack.end() || (it != byTrack.begin() && head - prev(it)->first < it->first - head)) {
+                it = prev(it);
+                it = byTrack.lower_bound(it->first);  // oldest request on that track
+            }
+            break;
+        }
+        case SCAN:
+        case LOOK:
+            if (ascending) {
+                it = byTrack.lower_bound(head);
+                if (it == byTrack.end()) {
+                    // Turn around, at the end of the disk for SCAN
+                    ascending = false;
+                    it = byTrack.lower_bound(prev(byTrack.end())->first);
+                    int turn = policy == SCAN ? lastTrack : head;
+                    seekDistance = (turn - head) + (turn - it->first);
+                }
+            } else {
+                it = byTrack.upper_bound(head);
+                if (it == byTrack.begin()) {
+                    // Turn around, at track 0 for SCAN
+                    ascending = true;
+                    int turn = policy == SCAN ? 0 : head;
+                    seekDistance = (head - turn) + (it->first - turn);
+                } else {
+                    it = byTrack.lower_bound(prev(it)->first);
+                }
+            }
+            break;
+        default:  // C-SCAN, C-LOOK: serve upwards only, then sweep back
+            it = byTrack.lower_bound(head);
+            if (it == byTrack.end()) {
+                it = byTrack.begin();
+                if (policy == CSCAN) {
+                    seekDistance = (lastTrack - head) + lastTrack + it->first;
+                } else {
+                    seekDistance = (head - it->first);
+                }
+            }
+            break;
+        }
+
+        op = it->second;
+        byTrack.erase(it);
+        if (seekDistance < 0) seekDistance = abs(op.track - head);
+        head = op.track;
+        return op;
+    }
+
+    // Takes a request the arm at head can serve on the same pass: one on its
+    // track or the next one up. FIFO only looks at the oldest request.
+    bool popNear(int& head, DiskOperation& op) {
+        if (policy == FIFO) {
+            if (fifo.empty() || fifo.front().track < head || fifo.front().track > head + 1) return false;
+            op = fifo.front();
+            fifo.pop_front();
+        } else {
+            Queue::iterator it = byTrack.lower_bound(head);
+            if (it == byTrack.end() || it->first > head + 1) return false;
+            op = it->second;
+            byTrack.erase(it);
+        }
+        op.seekTime = op.track - head;
+        head = op.track;
+        return true;
+    }
+
+private:
+    typedef multimap<int, DiskOperation> Queue;
+
+    Policy policy;
+    deque<DiskOperation> fifo;
+    Queue byTrack;
+    bool ascending = true;
+    int lastTrack = 0;
+};
+
+// One disk arm: the pending requests in scheduler order, where the head is
+// and what serving them has cost
+class DiskArm {
+public:
+    DiskArm(const DiskTiming& t, DiskScheduler::Policy p) : timing(t), queue(p), schedulerPolicy(p) {}
+
+    bool idle() const { return queue.empty(); }
+    void push(const DiskOperation& op) { queue.push(op); }
+
+    // Moves the head to the next request and returns the service time of
+    // the batch served there: that request plus, up to timing.maxBatch,
+    // whatever waits on the same or the next track, which costs a transfer
+    // (and a one-track step) each but no further rotation
+    SimTime serveNext(vector<DiskOperation>& batch, SimTime now) {
+        batch.clear();
+        int seekDistance;
+        DiskOperation op = queue.pop(headPosition, seekDistance);
+        op.seekTime = seekDistance;
+        SimTime service = timing.rotation;
+        do {
+            service += op.seekTime * timing.seekPerTrack + timing.transfer;
+            diskStats.operations++;
+            diskStats.prefetches += op.type == DISK_PREFETCH;
+            diskStats.writes += op.type == DISK_WRITE;
+            diskStats.tracksMoved += op.seekTime;
+            diskStats.queueTime += now - op.queuedAt;
+            batch.push_back(op);
+        } while (static_cast<int>(batch.size()) < timing.maxBatch && queue.popNear(headPosition, op));
+        diskStats.batches++;
+        diskStats.busyTime += service;
+        return service;
+    }
+
+    const DiskStats& stats() const { return diskStats; }
+    DiskScheduler::Policy policy() const { return schedulerPolicy; }
+
+private:
+    DiskTiming timing;
+    DiskScheduler queue;
+    DiskScheduler::Policy schedulerPolicy;
+    int headPosition = 0;
+    DiskStats diskStats;
+};
+
+// The disk in virtual time: one arm, busy with at most one request
+class DiskModel {
+public:
+    DiskModel(const DiskTiming& t, DiskScheduler::Policy policy) : arm(t, policy) {}
+
+    // Queues op at the current virtual time without starting the disk, so
+    // requests issued together can be served together
+    void queue(DiskOperation op, EventQueue& events) {
+        op.queuedAt = events.now();
+        arm.push(op);
+    }
+
+    // Starts the next batch if the disk is idle
+    void start(EventQueue& events) {
+        if (!busy) startNext(events);
+    }
+
+    void submit(const DiskOperation& op, EventQueue& events) {
+        queue(op, events);
+        start(events);
+    }
+
+    // The batch in service finished now: returns it (valid until the next
+    // call) and starts the next
+    const vector<DiskOperation>& complete(EventQueue& events) {
+        done.swap(current);
+        busy = false;
+        startNext(events);
+        return done;
+    }
+
+    const DiskStats& stats() const { return arm.stats(); }
+
+private:
+    DiskArm arm;
+    vector<DiskOperation> current, done;
+    bool busy = false;
+
+    void startNext(EventQueue& events) {
+        if (arm.idle()) return;
+        SimTime service = arm.serveNext(current, events.now());
+        busy = true;
+        events.schedule(events.now() + service, EVENT_IO_DONE, -1);
+    }
+};
+
+// Bounded lock-free multi-producer/single-consumer queue of disk requests
+// (Vyukov's ring: each cell's sequence number says whether it is free for
+// the producer claiming that position or filled for the consumer). Producers
+// spin only while the ring is full. The consumer sleeps on a condition
+// variable when it runs dry; producers take the mutex only when it does.
+class DiskRequestRing {
+public:
+    explicit DiskRequestRing(size_t capacity = 4096) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++) cells[i].seq.store(i, memory_order_relaxed);
+    }
+
+    bool tryPush(const DiskOperation& op) {
+        uint64_t pos = tail.load(memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            int64_t diff = static_cast<int64_t>(cell.seq.load(memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, memory_order_seq_cst, memory_order_relaxed)) {
+                    cell.op = op;
+                    cell.seq.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(const DiskOperation& op) {
+        while (!tryPush(op)) this_thread::yield();
+        // Either the consumer's check of tail saw our claim, or we see it asleep
+        if (sleeping.load()) {
+            lock_guard<mutex> lock(sleepMutex);
+            wake.notify_one();
+        }
+    }
+
+    // Consumer only
+    bool tryPop(DiskOperation& op) {
+        Cell& cell = cells[head & mask];
+        if (cell.seq.load(memory_order_acquire) != head + 1) return false;
+        op = cell.op;
+        cell.seq.store(head + mask + 1, memory_order_release);
+        head++;
+        return true;
+    }
+
+    // Consumer only: waits for a request, false once closed and drained
+    bool pop(DiskOperation& op) {
+        for (int spin = 0; spin < 64; spin++) {
+            if (tryPop(op)) return true;
+        }
+        unique_lock<mutex> lock(sleepMutex);
+        for (;;) {
+            sleeping.store(true);
+            bool done = closed.load();
+            if (tail.load() != head || done) {
+                sleeping.store(false);
+                lock.unlock();
+                // A producer has claimed the slot; wait for it to be filled
+                while (!tryPop(op)) {
+                    if (done && tail.load() == head) return false;
+                    this_thread::yield();
+                }
+                return true;
+            }
+            wake.wait(lock);
+        }
+    }
+
+    // Called once every producer is done
+    void close() {
+        lock_guard<mutex> lock(sleepMutex);
+        closed.store(true, memory_order_release);
+        wake.notify_one();
+    }
+
+private:
+    struct Cell {
+        atomic<uint64_t> seq;
+        DiskOperation op;
+    };
+
+    unique_ptr<Cell[]> cells;
+    size_t mask;
+    char pad0[64];  // keep the producers' tail and the consumer's head on separate cache lines
+    atomic<uint64_t> tail{0};
+    char pad1[64];
+    uint64_t head = 0;
+    atomic<bool> sleeping{false};
+    atomic<bool> closed{false};
+    mutex sleepMutex;
+    condition_variable wake;
+};
+
+// Snapshot file (--checkpoint/--resume): a SnapshotHeader, the run's
+// SimParams and then the simulator's state. Every structure lists its fields
+// once, in a transfer(archive) member that both SnapshotWriter and
+// SnapshotReader go through, so saving and restoring can't drift apart.
+// Plain values are stored as their bytes and arrays as a 64-bit length and
+// their elements, which makes restoring a handful of memcpys out of the
+// mapped file. Snapshots are for the machine that wrote them.
+const char SNAPSHOT_MAGIC[8] = {'D', 'P', 'T', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t processCount;
+    uint64_t position;    // trace position the run goes on from
+    uint64_t traceCount;  // references in the trace it was taken on
+    char algorithm[24];
+    uint32_t hasMetrics;
+    uint32_t reserved;
+};
+
+class SnapshotWriter {
+public:
+    template <class T>
+    void operator()(const T& value) {
+        static_assert(is_trivially_copyable<T>::value, "plain values only");
+        append(&value, sizeof(T));
+    }
+
+    template <class T>
+    void operator()(const vector<T>& values) {
+        uint64_t n = values.size();
+        (*this)(n);
+        block(values.data(), values.size());
+    }
+
+    template <class T>
+    void block(const T* values, size_t n) { append(values, n * sizeof(T)); }
+
+    // Writes the snapshot next to path and renames it into place, so an
+    // interrupted write never leaves a torn snapshot behind
+    void save(const string& path) const {
+        string temp = path + ".tmp";
+        FILE* out = fopen(temp.c_str(), "wb");
+        bool written = out && fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+        if (out && fclose(out) != 0) written = false;
+        if (!written || rename(temp.c_str(), path.c_str()) != 0) {
+            cerr << "Unable to write snapshot " << path << endl;
+            exit(1);
+        }
+    }
+
+private:
+    vector<char> bytes;
+
+    void append(const void* data, size_t n) {
+        const char* p = static_cast<const char*>(data);
+        bytes.insert(bytes.end(), p, p + n);
+    }
+};
+
+class SnapshotReader {
+public:
+    SnapshotReader(const char* begin, const char* end) : at(begin), limit(end) {}
+
+    template <class T>
+    void operator()(T& value) {
+        static_assert(is_trivially_copyable<T>::value, "plain values only");
+        take(&value, sizeof(T));
+    }
+
+    template <class T>
+    void operator()(vector<T>& values) {
+        uint64_t n = 0;
+        (*this)(n);
+        if (n > static_cast<uint64_t>(limit - at) / sizeof(T)) {
+            n = 0;
+            failed = true;
+        }
+        values.resize(static_cast<size_t>(n));
+        block(values.data(), values.size());
+    }
+
+    template <class T>
+    void block(T* values, size_t n) { take(values, n * sizeof(T)); }
+
+    bool ok() const { return !failed; }
+    const char* position() const { return at; }
+
+private:
+    const char* at;
+    const char* limit;
+    bool failed = false;
+
+    void take(void* data, size_t n) {
+        if (failed || n > static_cast<size_t>(limit - at)) {
+            failed = true;
+            return;
+        }
+        if (n) memcpy(data, at, n);  // empty vectors have no data()
+        at += n;
+    }
+};
+
+// A snapshot file mapped read-only; exits if it can't be used
+class Snapshot {
+public:
+    explicit Snapshot(const string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+            if (fd >= 0) close(fd);
+            cerr << "Unable to open snapshot " << path << endl;
+            exit(1);
+        }
+        mapping.length = static_cast<size_t>(info.st_size);
+        mapping.base = mmap(nullptr, mapping.length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping.base == MAP_FAILED) {
+            cerr << "Unable to map snapshot " << path << endl;
+            exit(1);
+        }
+        madvise(mapping.base, mapping.length, MADV_SEQUENTIAL);
+        const char* data = static_cast<const char*>(mapping.base);
+        memcpy(&header, data, sizeof(header));
+        SnapshotReader in(data + sizeof(header), data + mapping.length);
+        params.transfer(in);
+        if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != SNAPSHOT_VERSION || !in.ok()) {
+            cerr << "Unsupported or corrupt snapshot file!" << endl;
+            exit(1);
+        }
+        body = in.position();
+    }
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    SnapshotHeader header;
+    SimParams params;  // of the run that took it
+
+    string algorithm() const { return string(header.algorithm, strnlen(header.algorithm, sizeof(header.algorithm))); }
+    // The simulator state, after the params
+    SnapshotReader state() const {
+        return SnapshotReader(body, static_cast<const char*>(mapping.base) + mapping.length);
+    }
+
+private:
+    MappedTrace mapping;
+    const char* body = nullptr;
+};
+
+// One independent simulation run: its own processes, resident sets and disk
+// frames over the shared read-only trace, so any number of runs can go at
+// once without seeing each other's state
+class Simulator {
+public:
+    Simulator(const vector<Process>& config, const TraceView& refs, const SimParams& p)
+        : processes(config), trace(refs), params(p), processSlot(config) {
+        timing.maxBatch = max(params.ioBatch, 1);
+        if (params.frames > 0) {
+            for (auto& process : processes) {
+                process.size = params.frames;
+                process.pageTable.reserve(params.frames);
+            }
+        }
+        // Every process's resident set, carved out of one allocation
+        size_t frames = 0;
+        for (const auto& process : processes) frames += max(process.size, 1);
+        residentArena.assign(frames * ResidentSet::intsPerPage(), 0);
+        int* memory = residentArena.data();
+        for (auto& process : processes) {
+            process.pages.attach(memory, max(process.size, 1));
+            memory += max(process.size, 1) * ResidentSet::intsPerPage();
+        }
+    }
+
+    vector<Process> processes;
+    DiskRequestRing* faultRing = nullptr;  // where runProcess() sends disk requests, if anywhere
+    vector<ProcessMetrics> metrics;        // per process, with --metrics
+    unique_ptr<BufferedWriter> log;        // disk operations, with --verbose
+
+    // Turns on --metrics collection; call before running
+    void enableMetrics() {
+        metrics.assign(processes.size(), ProcessMetrics());
+        for (size_t i = 0; i < processes.size(); i++) {
+            metrics[i].processID = processes[i].id;
+            processes[i].metrics = &metrics[i];
+        }
+    }
+
+    // Hands over the collected metrics, merged per policy
+    RunMetrics takeMetrics(const string& algorithm) {
+        RunMetrics run;
+        run.algorithm = algorithm;
+        run.total.minWorkset = numeric_limits<size_t>::max();
+        for (size_t i = 0; i < metrics.size(); i++) {
+            const Process& process = processes[i];
+            bool hit = process.minWorkset != numeric_limits<size_t>::max();
+            metrics[i].minWorkset = hit ? process.minWorkset : 0;
+            metrics[i].maxWorkset = process.maxWorkset;
+            metrics[i].lastUse = PageTable();
+            processes[i].metrics = nullptr;
+            run.total.merge(metrics[i]);
+        }
+        if (run.total.minWorkset == numeric_limits<size_t>::max()) run.total.minWorkset = 0;
+        run.processes.swap(metrics);
+        return run;
+    }
+
+    int processIndex(int processID) const { return processSlot(processID); }
+    const DiskTiming& diskTiming() const { return timing; }
+
+    template <class Policy>
+    void prepare() {
+        for (auto& process : processes) {
+            Policy::configure(process, params);
+            // WS only drops pages as they leave the window, so a page read
+            // ahead and never used would stay resident for good
+            process.io.mode = Policy::usesWindow ? READAHEAD_OFF : params.readAhead;
+            process.io.depth = params.readAheadPages;
+            process.io.writeThreshold = static_cast<uint64_t>(params.writeRatio * 4294967296.0);
+            process.io.collectWritebacks = timed || faultRing;
+        }
+    }
+
+    template <class Policy>
+    void runSimulation() {
+        prepare<Policy>();
+        runRange<Policy>(0, trace.size());
+    }
+
+    // Replays trace positions [begin, end); prepare() must have been called
+    template <class Policy>
+    void runRange(size_t begin, size_t end) {
+        // trace holds the page requests for simulation, walked in place
+        for (size_t i = begin; i < end; i++) {
+            runReference<Policy>(trace[i], i);
+        }
+    }
+
+    // One reference, at trace position pos (streamed traces have no TraceView)
+    template <class Policy>
+    void runReference(const DPT& line, size_t pos) {
+        Process* proc = findProcess(line.processID);
+        if (proc && !proc->isFinished) {
+            accessPage<Policy>(*proc, line.pageNumber, line.time, pos);
+        }
+    }
+
+    // A streamed trace found the next use of a page after its last reference ran
+    template <class Policy>
+    void learnNextUse(int processID, int pageNumber, size_t next) {
+        Process* proc = findProcess(processID);
+        if (!proc) return;
+        int slot = proc->pageTable.find(pageKey(pageNumber));
+        if (slot != PageTable::NOT_FOUND) Policy::onNextUse(*proc, slot, next);
+    }
+
+    void runSimulation(const string& algorithm);
+
+    // Runs to the end of the trace from the start, or from where a snapshot
+    // of the same trace and config left off, and saves a snapshot of its own
+    // before trace position saveAt (no earlier than that) if saveTo is set
+    template <class Policy>
+    void runCheckpointed(const Snapshot* from, const string& saveTo, size_t saveAt) {
+        size_t begin = 0;
+        if (from) begin = restore<Policy>(*from); else prepare<Policy>();
+        if (!saveTo.empty()) {
+            runRange<Policy>(begin, saveAt);
+            checkpoint<Policy>(saveTo, saveAt);
+            begin = saveAt;
+        }
+        runRange<Policy>(begin, trace.size());
+    }
+
+    void runCheckpointed(const string& algorithm, const Snapshot* from, const string& saveTo, size_t saveAt);
+
+    // Snapshot of the run with trace positions [0, position) done
+    template <class Policy>
+    void checkpoint(const string& path, size_t position) {
+        SnapshotHeader header = SnapshotHeader();
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.processCount = static_cast<uint32_t>(processes.size());
+        header.position = position;
+        header.traceCount = trace.size();
+        strncpy(header.algorithm, Policy::name(), sizeof(header.algorithm) - 1);
+        header.hasMetrics = !metrics.empty();
+        SnapshotWriter out;
+        out(header);
+        params.transfer(out);
+        transferState(out, true, !metrics.empty());
+        out.save(path);
+    }
+
+    // Picks up a snapshot's state and returns the trace position to go on
+    // from. Under the policy that took it the run continues exactly where it
+    // stopped. Any other policy gets the resident pages as they were and
+    // builds its own order over them (see rebuildPolicy()). Metrics carry
+    // on if the snapshot has them, otherwise they count from here.
+    template <class Policy>
+    size_t restore(const Snapshot& from) {
+        bool samePolicy = from.algorithm() == Policy::name();
+        vector<int> ids;
+        for (const auto& process : processes) ids.push_back(process.id);
+        if (samePolicy) prepare<Policy>();  // the snapshot overwrites all of it
+        SnapshotReader in = from.state();
+        transferState(in, samePolicy, from.header.hasMetrics != 0);
+        bool sameConfig = in.ok();
+        for (size_t i = 0; i < processes.size(); i++) sameConfig = sameConfig && processes[i].id == ids[i];
+        if (!sameConfig) {
+            cerr << "Snapshot is corrupt or was taken with a different config!" << endl;
+            exit(1);
+        }
+        if (!samePolicy) {
+            prepare<Policy>();
+            rebuildPolicy<Policy>(static_cast<size_t>(from.header.position));
+        }
+        return static_cast<size_t>(from.header.position);
+    }
+
+    // Puts every resident page into a freshly prepared policy as if it had
+    // just been read in without a reference, oldest access first; LFU gets
+    // its counts back through Policy::restore(). History the policy keeps
+    // beyond that (ghosts, LRU-K references, reference bits) starts out
+    // empty, WS refills its window from the trace (refillWindows()). OPT learns
+    // each page's next use from one scan ahead of position that stops once
+    // every resident page has turned up.
+    template <class Policy>
+    void rebuildPolicy(size_t position) {
+        size_t unseen = 0;
+        for (auto& process : processes) {
+            vector<int> slots(process.pages.size());
+            for (size_t i = 0; i < slots.size(); i++) slots[i] = static_cast<int>(i);
+            stable_sort(slots.begin(), slots.end(), [&process](int a, int b) {
+                return process.pages.accessTime(a) < process.pages.accessTime(b);
+            });
+            for (int slot : slots) {
+                Policy::onFault(process, process.pages.pageNumber(slot), LookaheadIndex::NO_REFERENCE);
+                Policy::onInsert(process, slot, LookaheadIndex::NO_REFERENCE);
+            }
+            Policy::restore(process, slots);
+            unseen += slots.size();
+        }
+        if (Policy::usesWindow) refillWindows<Policy>(position);
+        if (!Policy::needsNextUse) return;
+        PageTable seen;
+        for (size_t i = position; i < trace.size() && unseen > 0; i++) {
+            const DPT& line = trace[i];
+            Process* proc = findProcess(line.processID);
+            if (!proc || proc->pageTable.find(pageKey(line.pageNumber)) == PageTable::NOT_FOUND) continue;
+            uint64_t key = frameKey(line.processID, line.pageNumber);
+            if (seen.find(key) != PageTable::NOT_FOUND) continue;
+            seen.set(key, 1);
+            learnNextUse<Policy>(line.processID, line.pageNumber, i);
+            unseen--;
+        }
+    }
+
+    // WS: every process's window gets back the references it made just
+    // before position, and a resident page that isn't among them goes, as it
+    // would have when it slid out. The scan back stops once every window is
+    // full, or at the start of the trace.
+    template <class Policy>
+    void refillWindows(size_t position) {
+        size_t window = static_cast<size_t>(max(1, params.wsWindow));
+        vector<vector<int>> recent(processes.size());
+        size_t open = processes.size();
+        for (size_t i = position; i-- > 0 && open > 0;) {
+            int p = processSlot(trace[i].processID);
+            if (p < 0 || recent[p].size() == window) continue;
+            recent[p].push_back(trace[i].pageNumber);
+            if (recent[p].size() == window) open--;
+        }
+        for (size_t p = 0; p < processes.size(); p++) {
+            Process& process = processes[p];
+            reverse(recent[p].begin(), recent[p].end());
+            process.eviction.window.refill(recent[p]);
+            for (int slot = static_cast<int>(process.pages.size()) - 1; slot >= 0; slot--) {
+                if (!process.eviction.window.contains(process.pages.pageNumber(slot))) removePageAt<Policy>(process, slot);
+            }
+        }
+    }
+
+    // Every process, the disk frames and (if wanted) the metrics
+    template <class Archive>
+    void transferState(Archive& archive, bool withEviction, bool withMetrics) {
+        for (auto& process : processes) process.transfer(archive, withEviction);
+        archive(diskFrames);
+        diskFrameTable.transfer(archive);
+        if (!withMetrics) return;
+        for (size_t i = 0; i < processes.size(); i++) {
+            ProcessMetrics skipped;
+            (metrics.empty() ? skipped : metrics[i]).transfer(archive);
+        }
+    }
+
+    // Replays only processes[procIndex]'s slice of the trace. Touches nothing
+    // but that process, so different processes can run on different threads.
+    template <class Policy>
+    void runProcess(size_t procIndex, const TracePartition& part) {
+        Process& proc = processes[procIndex];
+        for (const uint32_t* pos = part.begin(procIndex); pos != part.end(procIndex); ++pos) {
+            if (proc.isFinished) break;
+            const DPT& line = trace[*pos];
+            if (accessPage<Policy>(proc, line.pageNumber, line.time, *pos) && faultRing) {
+                faultRing->push(diskRequest(proc.id, line.pageNumber, DISK_READ));
+                for (int page : proc.io.prefetched) faultRing->push(diskRequest(proc.id, page, DISK_PREFETCH));
+                proc.io.prefetched.clear();
+                if (proc.io.writebacks.size() >= static_cast<size_t>(timing.maxBatch)) sendWritebacks(proc);
+            }
+        }
+        if (faultRing) sendWritebacks(proc);
+    }
+
+    // Pushes the process's pending writebacks to the disk driver
+    void sendWritebacks(Process& proc) {
+        for (int page : proc.io.writebacks) faultRing->push(diskRequest(proc.id, page, DISK_WRITE));
+        proc.io.writebacks.clear();
+    }
+
+    // Appends one task per process (weighted by its reference count) that
+    // runs this simulator's share of `algorithm` under --parallel
+    void addProcessTasks(const string& algorithm, const TracePartition& part,
+                         vector<function<void()>>& tasks, vector<size_t>& weights);
+
+    static DiskOperation diskRequest(int processID, int pageNumber, DiskOpType type) {
+        DiskOperation op = DiskOperation();
+        op.processID = processID;
+        op.pageNumber = pageNumber;
+        op.type = type;
+        return op;
+    }
+
+    // Disk frame holding a page, allocated the first time the page is seen
+    int diskFrame(int processID, int pageNumber) {
+        // Find the corresponding frame
+        uint64_t key = frameKey(processID, pageNumber);
+        int id = diskFrameTable.find(key);
+
+        if (id == PageTable::NOT_FOUND) {
+            // No frame found, simulate disk loading
+            Frame newFrame = {static_cast<int>(diskFrames.size()), pageNumber, processID};
+            diskFrameTable.set(key, newFrame.id);
+            diskFrames.push_back(newFrame);
+            id = newFrame.id;
+        }
+        return id;
+    }
+
+    // Replays the trace in virtual time: every fault costs the handler time
+    // plus a read on the simulated disk, and the faulting process stalls
+    // until it completes while the others keep running. Pages read ahead
+    // count as resident from the fault on; their reads go to the disk with
+    // the faulting one but nobody waits for them. Dirty pages are written
+    // behind, in clusters of up to --io-batch, and when the process exits.
+    // Needs the per-process split of the trace (buildPartition()).
+    template <class Policy>
+    void runTimed(const TracePartition& part, DiskScheduler::Policy diskPolicy) {
+        timed = true;
+        prepare<Policy>();
+        diskScheduler = diskPolicy;
+        EventQueue events;
+        DiskModel disk(timing, diskPolicy);
+        vector<size_t> cursor(processes.size(), 0);
+        vector<SimTime> faultedAt(processes.size(), 0);
+        for (size_t p = 0; p < processes.size(); p++) {
+            if (part.count(p)) events.schedule(0, EVENT_RUN, static_cast<int>(p));
+        }
+
+        while (!events.empty()) {
+            Event ev = events.next();
+            if (ev.type == EVENT_RUN) {
+                // Run until the next fault; independent of every other
+                // process, so the whole stretch is one event
+                Process& proc = processes[ev.target];
+                const uint32_t* refs = part.begin(ev.target);
+                SimTime t = ev.time;
+                bool faulted = false;
+                while (!faulted && cursor[ev.target] < part.count(ev.target)) {
+                    uint32_t pos = refs[cursor[ev.target]++];
+                    t += timing.perReference;
+                    faulted = accessPage<Policy>(proc, trace[pos].pageNumber, trace[pos].time, pos);
+                }
+                if (faulted) {
+                    faultedAt[ev.target] = t;
+                    events.schedule(t + timing.faultService, EVENT_IO_REQUEST, ev.target);
+                } else {
+                    proc.isFinished = true;
+                    runTime = max(runTime, t);
+                    queueWritebacks(proc, disk, events);
+                    disk.start(events);
+                }
+            } else if (ev.type == EVENT_IO_REQUEST) {
+                Process& proc = processes[ev.target];
+                const DPT& missed = trace[part.begin(ev.target)[cursor[ev.target] - 1]];
+                disk.queue(swapRequest(proc.id, missed.pageNumber, DISK_READ), events);
+                for (int page : proc.io.prefetched) disk.queue(swapRequest(proc.id, page, DISK_PREFETCH), events);
+                proc.io.prefetched.clear();
+                if (proc.io.writebacks.size() >= static_cast<size_t>(timing.maxBatch)) {
+                    queueWritebacks(proc, disk, events);
+                }
+                disk.start(events);
+            } else {
+                for (const DiskOperation& done : disk.complete(events)) {
+                    int p = processSlot(done.processID);
+                    if (!metrics.empty()) {
+                        if (done.type == DISK_WRITE) metrics[p].diskWrites++; else metrics[p].diskReads++;
+                        metrics[p].seekDistance += done.seekTime;
+                    }
+                    if (log) {
+                        const char* action = done.type == DISK_WRITE ? " written to" :
+                                             done.type == DISK_PREFETCH ? " read ahead from" : " read from";
+                        *log << "t=" << events.now() << "us process " << done.processID << " page " << done.pageNumber
+                             << action << " track " << done.track << ", seek " << done.seekTime << "\n";
+                    }
+                    if (done.type != DISK_READ) continue;
+                    faultServiceTime += events.now() - faultedAt[p];
+                    events.schedule(events.now(), EVENT_RUN, p);
+                }
+            }
+        }
+        diskStats = disk.stats();
+    }
+
+    // A request with the page's swap slot filled in
+    DiskOperation swapRequest(int processID, int pageNumber, DiskOpType type) {
+        DiskOperation op = diskRequest(processID, pageNumber, type);
+        op.diskAddress = diskFrame(processID, pageNumber);
+        op.track = op.diskAddress / timing.pagesPerTrack;
+        return op;
+    }
+
+    // Queues the process's pending writebacks as one cluster, in swap order
+    void queueWritebacks(Process& proc, DiskModel& disk, EventQueue& events) {
+        vector<DiskOperation> writes;
+        for (int page : proc.io.writebacks) writes.push_back(swapRequest(proc.id, page, DISK_WRITE));
+        sort(writes.begin(), writes.end(), [](const DiskOperation& a, const DiskOperation& b) {
+            return a.diskAddress < b.diskAddress;
+        });
+        for (const auto& op : writes) disk.queue(op, events);
+        proc.io.writebacks.clear();
+    }
+
+    void runTimed(const string& algorithm, const TracePartition& part, DiskScheduler::Policy diskPolicy);
+
+    uint64_t totalFaults() const {
+        uint64_t faults = 0;
+        for (const auto& process : processes) faults += process.faultCount;
+        return faults;
+    }
+
+    void report(ostream& out, const string& algorithm) const {
+        for (const auto& process : processes) {
+            // Output the process
+            out << "Process ID: " << process.id << " - Page Faults: " << process.faultCount << "\n";
+            if (algorithm == "WS") {  // Only output workset sizes for the Working Set algorithm
+                out << "Minimum Workset Size: " << process.minWorkset << "\n";
+                out << "Maximum Workset Size: " << process.maxWorkset << "\n";
+            }
+        }
+        if (algorithm == "WS" && params.wsSampleEvery > 0) reportWorksetTimeline(out);
+        if (params.readAhead != READAHEAD_OFF && algorithm != "WS") reportReadAhead(out);
+        if (timed) reportDisk(out);
+    }
+
+    // What read-ahead bought: every prefetched page referenced before its
+    // eviction is a fault that didn't happen. The disk time it saved (or
+    // cost) takes a run without read-ahead to compare against.
+    void reportReadAhead(ostream& out) const {
+        uint64_t prefetches = 0, hits = 0, wasted = 0;
+        for (const auto& process : processes) {
+            prefetches += process.io.prefetches;
+            hits += process.io.prefetchHits;
+            wasted += process.io.prefetchWasted;
+        }
+        out << "Prefetched Pages: " << prefetches << "\n";
+        out << "Prefetch Hits: " << hits << " (" << fixedPoint(prefetches ? 100.0 * hits / prefetches : 0)
+            << "% accuracy, " << wasted << " evicted unused)\n";
+        out << "Faults Avoided: " << hits << "\n";
+    }
+
+    // Working-set size of every process at every wsSampleEvery-th of its references
+    void reportWorksetTimeline(ostream& out) const {
+        out << "Workset Size Timeline (every " << params.wsSampleEvery << " references of each process):\n";
+        out << "process,reference,workset\n";
+        for (const auto& process : processes) {
+            const vector<uint32_t>& samples = process.eviction.window.samples();
+            for (size_t i = 0; i < samples.size(); i++) {
+                out << process.id << "," << (i + 1) * params.wsSampleEvery << "," << samples[i] << "\n";
+            }
+        }
+    }
+
+    // The disk side of a timed run
+    void reportDisk(ostream& out) const {
+        reportDiskStats(out, diskScheduler, diskStats);
+        uint64_t faults = diskStats.operations - diskStats.prefetches - diskStats.writes;
+        out << "Average Fault Service Time: " << fixedPoint(faults ? faultServiceTime / 1000.0 / faults : 0) << " ms\n";
+        out << "Simulated Run Time: " << fixedPoint(runTime / 1000.0) << " ms\n";
+    }
+
+    static void reportDiskStats(ostream& out, DiskScheduler::Policy policy, const DiskStats& stats) {
+        uint64_t ops = stats.operations;
+        out << "Disk Scheduler: " << DiskScheduler::name(policy) << "\n";
+        out << "Disk Reads: " << ops - stats.writes << "\n";
+        if (stats.prefetches) out << "Read-Ahead Reads: " << stats.prefetches << "\n";
+        if (stats.writes) out << "Disk Writes: " << stats.writes << "\n";
+        if (stats.batches < ops) {
+            out << "Coalesced Requests: " << ops - stats.batches << " (" << ops << " requests in "
+                << stats.batches << " arm visits)\n";
+        }
+        out << "Total I/O Time: " << fixedPoint(stats.busyTime / 1000.0) << " ms\n";
+        out << "Total Seek Distance: " << stats.tracksMoved << " tracks\n";
+        out << "Average Seek Distance: " << fixedPoint(ops ? static_cast<double>(stats.tracksMoved) / ops : 0) << " tracks\n";
+    }
+
+    static string fixedPoint(double value) {
+        ostringstream text;
+        text.setf(ios::fixed);
+        text.precision(3);
+        text << value;
+        return text.str();
+    }
+
+private:
+    TraceView trace;
+    SimParams params;
+    ProcessIndex processSlot;
+    DiskTiming timing;
+    bool timed = false;
+    DiskScheduler::Policy diskScheduler = DiskScheduler::FIFO;
+    DiskStats diskStats;
+    SimTime faultServiceTime = 0;  // summed fault-to-resume time
+    SimTime runTime = 0;           // when the last process finished
+    vector<int> residentArena;  // backs every process's ResidentSet
+    vector<Frame> diskFrames;
+    PageTable diskFrameTable;  // (processID, pageNumber) -> index into diskFrames
+
+    Process* findProcess(int id) {
+        int slot = processSlot(id);
+        return slot < 0 ? nullptr : &processes[slot];
+    }
+};
+
+struct RunSimulation {
+    Simulator& sim;
+    template <class Policy>
+    void operator()(Policy) const { sim.runSimulation<Policy>(); }
+};
+
+void Simulator::runSimulation(const string& algorithm) {
+    dispatchPolicy(algorithm, RunSimulation{*this});
+}
+
+struct RunCheckpointed {
+    Simulator& sim;
+    const Snapshot* from;
+    const string& saveTo;
+    size_t saveAt;
+    template <class Policy>
+    void operator()(Policy) const { sim.runCheckpointed<Policy>(from, saveTo, saveAt); }
+};
+
+void Simulator::runCheckpointed(const string& algorithm, const Snapshot* from, const string& saveTo, size_t saveAt) {
+    dispatchPolicy(algorithm, RunCheckpointed{*this, from, saveTo, saveAt});
+}
+
+// Disk driver thread of a --parallel run. The process tasks push their page
+// reads (and read-ahead and writebacks) onto the ring as they fault; the
+// driver gives each page its swap
+// slot and feeds it to one arm per disk scheduler, serving requests in
+// arrival order as far as the scheduler allows. There is no virtual time
+// here, so processes don't stall on the disk: this measures seek distance
+// and I/O time of the fault stream, not run time.
+class DiskDriver {
+public:
+    DiskDriver(Simulator& s, const vector<string>& schedulers) : sim(s), timing(s.diskTiming()) {
+        for (const auto& name : schedulers) {
+            DiskScheduler::Policy policy = DiskScheduler::FIFO;
+            DiskScheduler::parse(name, policy);
+            arms.push_back(DiskArm(timing, policy));
+        }
+        reads.assign(sim.processes.size(), 0);
+        writes.assign(sim.processes.size(), 0);
+        tracks.assign(sim.processes.size(), 0);
+        sim.faultRing = &ring;
+        worker = thread(&DiskDriver::run, this);
+    }
+
+    // Call once every process task has finished. The driver's per-process
+    // disk counts (for the first scheduler) go into the simulator's metrics.
+    void finish() {
+        ring.close();
+        worker.join();
+        sim.faultRing = nullptr;
+        for (size_t p = 0; p < sim.metrics.size(); p++) {
+            sim.metrics[p].diskReads += reads[p];
+            sim.metrics[p].diskWrites += writes[p];
+            sim.metrics[p].seekDistance += tracks[p];
+        }
+    }
+
+    void report(ostream& out) const {
+        for (const auto& arm : arms) {
+            Simulator::reportDiskStats(out, arm.policy(), arm.stats());
+        }
+    }
+
+private:
+    Simulator& sim;
+    DiskTiming timing;
+    DiskRequestRing ring;
+    vector<DiskArm> arms;
+    vector<uint64_t> reads, writes, tracks;  // per process slot, driver thread only
+    thread worker;
+
+    void served(const DiskOperation& op) {
+        int p = sim.processIndex(op.processID);
+        if (op.type == DISK_WRITE) writes[p]++; else reads[p]++;
+        tracks[p] += op.seekTime;
+        // The process tasks never log, so the driver has sim.log to itself
+        if (sim.log) {
+            const char* action = op.type == DISK_WRITE ? " written to" :
+                                 op.type == DISK_PREFETCH ? " read ahead from" : " read from";
+            *sim.log << "process " << op.processID << " page " << op.pageNumber << action << " track " << op.track
+                     << ", seek " << op.seekTime << " (" << DiskScheduler::name(arms[0].policy()) << ")\n";
+        }
+    }
+
+    void enqueue(DiskOperation op) {
+        op.diskAddress = sim.diskFrame(op.processID, op.pageNumber);
+        op.track = op.diskAddress / timing.pagesPerTrack;
+        for (auto& arm : arms) arm.push(op);
+    }
+
+    void run() {
+        DiskOperation op;
+        vector<DiskOperation> done;
+        while (ring.pop(op)) {  // sleeps while nothing is faulting
+            enqueue(op);
+            bool pending = true;
+            while (pending) {
+                // Take whatever arrived, then serve one request per arm
+                while (ring.tryPop(op)) enqueue(op);
+                pending = false;
+                for (size_t a = 0; a < arms.size(); a++) {
+                    if (arms[a].idle()) continue;
+                    arms[a].serveNext(done, 0);
+                    pending = pending || !arms[a].idle();
+                    if (a == 0) {
+                        for (const auto& request : done) served(request);
+                    }
+                }
+            }
+        }
+    }
+};
+
+struct RunTimed {
+    Simulator& sim;
+    const TracePartition& part;
+    DiskScheduler::Policy diskPolicy;
+    template <class Policy>
+    void operator()(Policy) const { sim.runTimed<Policy>(part, diskPolicy); }
+};
+
+void Simulator::runTimed(const string& algorithm, const TracePartition& part, DiskScheduler::Policy diskPolicy) {
+    dispatchPolicy(algorithm, RunTimed{*this, part, diskPolicy});
+}
+
+struct AddProcessTasks {
+    Simulator& sim;
+    const TracePartition& part;
+    vector<function<void()>>& tasks;
+    vector<size_t>& weights;
+
+    template <class Policy>
+    void operator()(Policy) const {
+        sim.prepare<Policy>();
+        for (size_t i = 0; i < sim.processes.size(); i++) {
+            Simulator* s = &sim;
+            const TracePartition* p = &part;
+            tasks.push_back([s, p, i] { s->runProcess<Policy>(i, *p); });
+            weights.push_back(part.count(i));
+        }
+    }
+};
+
+void Simulator::addProcessTasks(const string& algorithm, const TracePartition& part,
+                                vector<function<void()>>& tasks, vector<size_t>& weights) {
+    dispatchPolicy(algorithm, AddProcessTasks{*this, part, tasks, weights});
+}
+
+struct NeedsNextUse {
+    bool& result;
+    template <class Policy>
+    void operator()(Policy) const { result = Policy::needsNextUse; }
+};
+
+bool needsNextUse(const string& algorithm) {
+    bool result = false;
+    dispatchPolicy(algorithm, NeedsNextUse{result});
+    return result;
+}
+
+// Fixed set of worker threads draining a shared task queue
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads) {
+        if (threads == 0) threads = 1;
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    void submit(function<void()> task) {
+        {
+            lock_guard<mutex> lock(m);
+            tasks.push(move(task));
+            pending++;
+        }
+        taskReady.notify_one();
+    }
+
+    // Blocks until every submitted task has finished
+    void wait() {
+        unique_lock<mutex> lock(m);
+        allDone.wait(lock, [this] { return pending == 0; });
+    }
+
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex m;
+    condition_variable taskReady, allDone;
+    size_t pending = 0;
+    bool stopping = false;
+
+    void workerLoop() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(m);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = move(tasks.front());
+                tasks.pop();
+            }
+            task();
+            {
+                lock_guard<mutex> lock(m);
+                if (--pending == 0) allDone.notify_all();
+            }
+        }
+    }
+};
+
+size_t workerCount(size_t tasks) {
+    size_t cores = thread::hardware_concurrency();
+    return min(tasks, cores ? static_cast<size_t>(cores) : static_cast<size_t>(1));
+}
+
+// Runs a batch of independent, weighted tasks to completion on all cores.
+// Every worker owns a deque, dealt heaviest-first, and takes its heaviest
+// remaining task; once its own deque is empty it steals the heaviest task
+// left on another worker's deque. A single huge task therefore occupies one
+// worker while the rest keep draining everything else.
+class WorkStealingScheduler {
+public:
+    void run(vector<function<void()>>& tasks, const vector<size_t>& weights) {
+        size_t threads = workerCount(tasks.size());
+        if (threads == 0) return;
+
+        vector<size_t> order(tasks.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        stable_sort(order.begin(), order.end(),
+                    [&weights](size_t a, size_t b) { return weights[a] > weights[b]; });
+
+        queues = vector<WorkQueue>(threads);
+        for (size_t i = 0; i < order.size(); i++) {
+            queues[i % threads].items.push_front(order[i]); // heaviest ends up at the back
+        }
+
+        vector<thread> workers;
+        for (size_t w = 1; w < threads; w++) {
+            workers.emplace_back(&WorkStealingScheduler::workerLoop, this, w, ref(tasks));
+        }
+        workerLoop(0, tasks);
+        for (auto& worker : workers) worker.join();
+    }
+
+private:
+    struct WorkQueue {
+        mutex m;
+        deque<size_t> items;
+
+        bool pop(size_t& task) {
+            lock_guard<mutex> lock(m);
+            if (items.empty()) return false;
+            task = items.back();
+            items.pop_back();
+            return true;
+        }
+    };
+
+    vector<WorkQueue> queues;
+
+    void workerLoop(size_t self, vector<function<void()>>& tasks) {
+        size_t task;
+        while (true) {
+            if (!queues[self].pop(task)) {
+                // Nothing left of our own, try to steal. No task adds new
+                // work, so a full round of empty deques means we are done.
+                bool stolen = false;
+                for (size_t i = 1; i < queues.size() && !stolen; i++) {
+                    stolen = queues[(self + i) % queues.size()].pop(task);
+                }
+                if (!stolen) return;
+            }
+            tasks[task]();
+        }
+    }
+};
+
+SimParams defaultParams() {
+    SimParams params;
+    params.x = g_nX;
+    params.k = 2;
+    params.correlatedPeriod = 0;
+    params.wsWindow = 10;
+    params.wsSampleEvery = 0;
+    params.frames = 0;
+    params.readAhead = READAHEAD_OFF;
+    params.readAheadPages = 4;
+    params.writeRatio = 0;
+    params.ioBatch = 1;
+    return params;
+}
+
+// The defaults with a single run's --ws-window, --ws-timeline and paging
+// I/O switches applied
+SimParams defaultParams(const Options& options) {
+    SimParams params = defaultParams();
+    if (!options.sweepWindow.empty()) params.wsWindow = options.sweepWindow[0];
+    if (!options.sweepK.empty()) params.k = options.sweepK[0];
+    params.correlatedPeriod = options.correlatedPeriod;
+    params.wsSampleEvery = options.wsTimeline;
+    params.readAhead = options.readAhead;
+    params.readAheadPages = options.readAheadPages;
+    params.writeRatio = options.writeRatio;
+    params.ioBatch = options.ioBatch;
+    return params;
+}
+
+// Makes sure there is a trace to run and everything derived from it is
+// built before any simulation starts reading it
+void prepareTrace(const vector<string>& algorithms, const Options& options) {
+    if (!traceLoaded && trace.empty()) {
+        generateRandomTrace();
+    }
+    for (const auto& alg : algorithms) {
+        if (needsNextUse(alg)) buildNextUseIndex();
+    }
+    if (options.parallel || options.diskTiming) {
+        buildPartition();
+    }
+}
+
+// Applies --metrics and --verbose to a simulator about to run
+void instrument(Simulator& sim, const Options& options) {
+    if (!options.metricsFormat.empty()) sim.enableMetrics();
+    if (options.verbose) sim.log.reset(new BufferedWriter(stderr));
+}
+
+// Writes the metrics of every run to stdout as JSON or CSV. Histogram
+// buckets are named by their lower bound.
+void writeMetrics(const vector<RunMetrics>& runs, const string& format) {
+    BufferedWriter out(stdout);
+    const char* histogramNames[] = {"faultInterarrival", "reuseDistance"};
+    if (format == "csv") {
+        out << "algorithm,process,references,hits,faults,evictions,dirty_writebacks,prefetches,prefetch_hits,"
+               "min_workset,max_workset,disk_reads,disk_writes,seek_distance\n";
+        for (const auto& run : runs) {
+            for (size_t i = 0; i <= run.processes.size(); i++) {
+                const ProcessMetrics& m = i < run.processes.size() ? run.processes[i] : run.total;
+                out << run.algorithm << ',';
+                if (i < run.processes.size()) out << m.processID; else out << "all";
+                out << ',' << m.references << ',' << m.hits << ',' << m.faults << ',' << m.evictions << ','
+                    << m.dirtyWritebacks << ',' << m.prefetches << ',' << m.prefetchHits << ','
+                    << m.minWorkset << ',' << m.maxWorkset << ','
+                    << m.diskReads << ',' << m.diskWrites << ',' << m.seekDistance << '\n';
+            }
+        }
+        out << "\nalgorithm,process,histogram,bucket,count\n";
+        for (const auto& run : runs) {
+            for (size_t i = 0; i <= run.processes.size(); i++) {
+                const ProcessMetrics& m = i < run.processes.size() ? run.processes[i] : run.total;
+                const Log2Histogram* histograms[] = {&m.faultInterarrival, &m.reuseDistance};
+                for (int h = 0; h < 2; h++) {
+                    for (int b = 0; b < Log2Histogram::BUCKETS; b++) {
+                        if (!histograms[h]->counts[b]) continue;
+                        out << run.algorithm << ',';
+                        if (i < run.processes.size()) out << m.processID; else out << "all";
+                        out << ',' << histogramNames[h] << ',' << Log2Histogram::lowerBound(b) << ','
+                            << histograms[h]->counts[b] << '\n';
+                    }
+                }
+            }
+        }
+        return;
+    }
+
+    out << "{\"runs\": [";
+    for (size_t r = 0; r < runs.size(); r++) {
+        const RunMetrics& run = runs[r];
+        out << (r ? "," : "") << "\n  {\"algorithm\": \"" << run.algorithm << "\", \"processes\": [";
+        for (size_t i = 0; i <= run.processes.size(); i++) {
+            const ProcessMetrics& m = i < run.processes.size() ? run.processes[i] : run.total;
+            if (i == run.processes.size()) {
+                out << "\n   ], \"total\": {";
+            } else {
+                out << (i ? "," : "") << "\n    {\"process\": " << m.processID << ", ";
+            }
+            out << "\"references\": " << m.references << ", \"hits\": " << m.hits << ", \"faults\": " << m.faults
+                << ", \"evictions\": " << m.evictions << ", \"dirtyWritebacks\": " << m.dirtyWritebacks
+                << ", \"prefetches\": " << m.prefetches << ", \"prefetchHits\": " << m.prefetchHits
+                << ", \"minWorkset\": " << m.minWorkset << ", \"maxWorkset\": " << m.maxWorkset
+                << ", \"diskReads\": " << m.diskReads << ", \"diskWrites\": " << m.diskWrites
+                << ", \"seekDistance\": " << m.seekDistance;
+            const Log2Histogram* histograms[] = {&m.faultInterarrival, &m.reuseDistance};
+            for (int h = 0; h < 2; h++) {
+                out << ", \"" << histogramNames[h] << "\": {";
+                bool first = true;
+                for (int b = 0; b < Log2Histogram::BUCKETS; b++) {
+                    if (!histograms[h]->counts[b]) continue;
+                    out << (first ? "" : ", ") << '"' << Log2Histogram::lowerBound(b) << "\": " << histograms[h]->counts[b];
+                    first = false;
+                }
+                out << '}';
+            }
+            out << '}';
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+}
+
+// Simulates every (algorithm, process) pair as its own work-stealing task.
+// Each process only ever touches its own Process entry, so the merged report
+// is identical to a serial run. With --disk each simulator's faults also
+// stream to its own disk driver thread.
+void simulatePartitioned(const vector<string>& algorithms, const Options& options, vector<RunMetrics>& runs) {
+    vector<unique_ptr<Simulator>> sims;
+    vector<unique_ptr<DiskDriver>> drivers;
+    vector<function<void()>> tasks;
+    vector<size_t> weights;
+    vector<string> schedulers = options.diskSchedulers;
+    if (schedulers.empty()) schedulers.push_back("FIFO");
+    for (const auto& alg : algorithms) {
+        sims.emplace_back(new Simulator(processes, trace, defaultParams(options)));
+        instrument(*sims.back(), options);
+        if (options.diskTiming) drivers.emplace_back(new DiskDriver(*sims.back(), schedulers));
+        sims.back()->addProcessTasks(alg, processTraces, tasks, weights);
+    }
+    WorkStealingScheduler scheduler;
+    scheduler.run(tasks, weights);
+    for (auto& driver : drivers) driver->finish();
+
+    for (size_t i = 0; i < algorithms.size(); i++) {
+        if (!options.metricsFormat.empty()) {
+            runs[i] = sims[i]->takeMetrics(algorithms[i]);
+            continue;
+        }
+        if (algorithms.size() > 1) cout << "Running: " << algorithms[i] << "\n";
+        sims[i]->report(cout, algorithms[i]);
+        if (!drivers.empty()) drivers[i]->report(cout);
+    }
+    cout << flush;
+}
+
+// Timed runs of one algorithm, one per disk scheduler. The page faults
+// don't depend on the disk, so they are printed once followed by the disk
+// numbers of every scheduler; metrics come from the first scheduler's run.
+void simulateTimed(const string& algorithm, const Options& options, ostream& out, RunMetrics& run) {
+    vector<string> schedulers = options.diskSchedulers;
+    if (schedulers.empty()) schedulers.push_back("FIFO");
+    for (size_t i = 0; i < schedulers.size(); i++) {
+        DiskScheduler::Policy diskPolicy = DiskScheduler::FIFO;
+        DiskScheduler::parse(schedulers[i], diskPolicy);
+        Simulator sim(processes, trace, defaultParams(options));
+        instrument(sim, options);
+        sim.runTimed(algorithm, processTraces, diskPolicy);
+        if (!options.metricsFormat.empty()) {
+            if (i == 0) run = sim.takeMetrics(algorithm);
+        } else if (i == 0) {
+            sim.report(out, algorithm);
+        } else {
+            sim.reportDisk(out);
+        }
+    }
+}
+
+void simulate(const string& algorithm, const Options& options) {
+    simulateAll(vector<string>(1, algorithm), options);
+}
+
+// Runs every algorithm on its own Simulator, in parallel, and prints the
+// reports (or the metrics) in the order the algorithms were given
+void simulateAll(const vector<string>& algorithms, const Options& options) {
+    prepareTrace(algorithms, options);
+    // With --resume every algorithm branches off the same mapped snapshot
+    unique_ptr<Snapshot> snapshot;
+    if (!options.resumeFrom.empty()) {
+        snapshot.reset(new Snapshot(options.resumeFrom));
+        if (snapshot->header.traceCount != trace.size() || snapshot->header.processCount != processes.size()) {
+            cerr << "Snapshot " << options.resumeFrom << " was taken on a different trace or config!" << endl;
+            exit(1);
+        }
+    }
+    size_t start = snapshot ? static_cast<size_t>(snapshot->header.position) : 0;
+    if (!options.checkpointPath.empty() && (options.checkpointAt < start || options.checkpointAt > trace.size())) {
+        cerr << "--checkpoint-at must be between " << start << " and " << trace.size() << endl;
+        exit(1);
+    }
+    vector<RunMetrics> runs(algorithms.size());
+    if (options.parallel) {
+        simulatePartitioned(algorithms, options, runs);
+    } else {
+        vector<ostringstream> reports(algorithms.size());
+        {
+            ThreadPool pool(workerCount(algorithms.size()));
+            for (size_t i = 0; i < algorithms.size(); i++) {
+                pool.submit([i, &algorithms, &reports, &runs, &options, &snapshot] {
+                    if (options.diskTiming) {
+                        simulateTimed(algorithms[i], options, reports[i], runs[i]);
+                        return;
+                    }
+                    // A snapshot's own policy goes on with the snapshot's settings
+                    bool samePolicy = snapshot && snapshot->algorithm() == algorithms[i];
+                    Simulator sim(processes, trace, samePolicy ? snapshot->params : defaultParams(options));
+                    instrument(sim, options);
+                    if (snapshot || !options.checkpointPath.empty()) {
+                        sim.runCheckpointed(algorithms[i], snapshot.get(), options.checkpointPath, options.checkpointAt);
+                    } else {
+                        sim.runSimulation(algorithms[i]);
+                    }
+                    if (!options.metricsFormat.empty()) {
+                        runs[i] = sim.takeMetrics(algorithms[i]);
+                    } else {
+                        sim.report(reports[i], algorithms[i]);
+                    }
+                });
+            }
+            pool.wait();
+        }
+        if (options.metricsFormat.empty()) {
+            for (size_t i = 0; i < algorithms.size(); i++) {
+                if (algorithms.size() > 1) cout << "Running: " << algorithms[i] << "\n";
+                cout << reports[i].str();
+            }
+            cout << flush;
+        }
+    }
+    if (!options.metricsFormat.empty()) writeMetrics(runs, options.metricsFormat);
+}
+
+// Streamed traces (stdin or a pipe). A parser thread turns the input into
+// chunks of references while the simulation consumes them, and nothing but
+// a few chunks and OPT's lookahead is ever held, however long the trace is.
+
+// Chunks of parsed references on their way from the parser thread to the
+// simulation. Only `depth` buffers exist: the parser waits for the
+// simulation to hand one back before filling it again.
+class ChunkQueue {
+public:
+    static const size_t CHUNK = 1 << 16;  // references per chunk
+
+    explicit ChunkQueue(size_t depth) : spare(depth) {
+        for (auto& chunk : spare) chunk.reserve(CHUNK);
+    }
+
+    // An empty buffer for the parser
+    vector<DPT> acquire() {
+        unique_lock<mutex> lock(m);
+        changed.wait(lock, [this] { return !spare.empty(); });
+        vector<DPT> chunk = move(spare.back());
+        spare.pop_back();
+        return chunk;
+    }
+
+    void push(vector<DPT> chunk) {
+        lock_guard<mutex> lock(m);
+        ready.push_back(move(chunk));
+        changed.notify_all();
+    }
+
+    // No more chunks are coming
+    void close() {
+        lock_guard<mutex> lock(m);
+        closed = true;
+        changed.notify_all();
+    }
+
+    // The next chunk in input order; false once the parser is done
+    bool pop(vector<DPT>& chunk) {
+        unique_lock<mutex> lock(m);
+        changed.wait(lock, [this] { return !ready.empty() || closed; });
+        if (ready.empty()) return false;
+        chunk = move(ready.front());
+        ready.pop_front();
+        return true;
+    }
+
+    // Gives a consumed buffer back to the parser
+    void release(vector<DPT> chunk) {
+        chunk.clear();
+        lock_guard<mutex> lock(m);
+        spare.push_back(move(chunk));
+        changed.notify_all();
+    }
+
+private:
+    mutex m;
+    condition_variable changed;
+    deque<vector<DPT>> ready;
+    vector<vector<DPT>> spare;
+    bool closed = false;
+};
+
+const size_t ChunkQueue::CHUNK;
+
+// Reads references from a stream a buffer at a time: the binary trace
+// format (recognised by its header, the count is ignored) or text triples,
+// parsed by hand the way `in >> pid >> page >> time` would and stopping at
+// the first thing that isn't a number.
+class TraceStream {
+public:
+    explicit TraceStream(FILE* input) : in(input), buffer(1 << 16) {
+        binary = ensure(sizeof(TRACE_MAGIC)) && memcmp(buffer.data() + begin, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+        if (binary) {
+            TraceHeader header;
+            if (!readBytes(reinterpret_cast<char*>(&header), sizeof(header)) || header.version != TRACE_VERSION ||
+                header.recordSize != sizeof(DPT)) {
+                cerr << "Unsupported or corrupt trace stream!" << endl;
+                exit(1);
+            }
+        }
+    }
+
+    // Appends references to chunk until it holds `limit` or the input ends;
+    // returns false once there is nothing more to read
+    bool read(vector<DPT>& chunk, size_t limit) {
+        DPT dpt;
+        while (!finished && chunk.size() < limit) {
+            bool ok = binary ? readBytes(reinterpret_cast<char*>(&dpt), sizeof(dpt))
+                             : readInt(dpt.processID) && readInt(dpt.pageNumber) && readInt(dpt.time);
+            if (!ok) {
+                finished = true;
+                break;
+            }
+            chunk.push_back(dpt);
+        }
+        return !finished;
+    }
+
+private:
+    FILE* in;
+    vector<char> buffer;
+    size_t begin = 0, end = 0;
+    bool binary = false;
+    bool finished = false;
+
+    // Makes sure n unread bytes are buffered; false if the input ends first
+    bool ensure(size_t n) {
+        if (end - begin >= n) return true;
+        memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+        while (end < n) {
+            size_t got = fread(buffer.data() + end, 1, buffer.size() - end, in);
+            if (got == 0) return false;
+            end += got;
+        }
+        return true;
+    }
+
+    // Next byte without consuming it, EOF at the end of the input
+    int peek() { return ensure(1) ? static_cast<unsigned char>(buffer[begin]) : EOF; }
+
+    bool readBytes(char* out, size_t n) {
+        if (!ensure(n)) return false;
+        memcpy(out, buffer.data() + begin, n);
+        begin += n;
+        return true;
+    }
+
+    bool readInt(int& value) {
+        int c = peek();
+        while (c != EOF && isspace(c)) {
+            begin++;
+            c = peek();
+        }
+        bool negative = c == '-';
+        if (c == '-' || c == '+') {
+            begin++;
+            c = peek();
+        }
+        if (c == EOF || !isdigit(c)) return false;
+        long long n = 0;
+        while (c != EOF && isdigit(c)) {
+            n = n * 10 + (c - '0');
+            begin++;
+            c = peek();
+        }
+        value = static_cast<int>(negative ? -n : n);
+        return true;
+    }
+};
+
+// The references from the one being simulated up to X ahead of it, in a
+// ring, with the distance from each to the same page's next reference once
+// that has been read. lastSeen only holds references not simulated yet, so
+// it stays as small as the ring.
+class LookaheadRing {
+public:
+    explicit LookaheadRing(size_t span) {
+        size_t size = 1;
+        while (size < span) size <<= 1;
+        refs.resize(size);
+        distance.assign(size, LookaheadIndex::NEVER);
+        ringMask = size - 1;
+    }
+
+    const DPT& operator[](size_t pos) const { return refs[pos & ringMask]; }
+    const uint32_t* distances() const { return distance.data(); }
+    size_t mask() const { return ringMask; }
+
+    // Adds the reference at position pos. Returns false if the page's
+    // previous reference has already been simulated (or there is none), in
+    // which case the simulators have to be told about its next use.
+    bool add(const DPT& ref, size_t pos) {
+        refs[pos & ringMask] = ref;
+        distance[pos & ringMask] = LookaheadIndex::NEVER;
+        uint64_t key = frameKey(ref.processID, ref.pageNumber);
+        int previous = lastSeen.find(key);
+        lastSeen.set(key, wrap(pos));
+        if (previous == PageTable::NOT_FOUND) return false;
+        uint32_t gap = static_cast<uint32_t>(wrap(pos) - previous) & POSITION_MASK;
+        distance[(pos - gap) & ringMask] = gap;
+        return true;
+    }
+
+    // Position pos has been simulated
+    void retire(size_t pos) {
+        const DPT& ref = refs[pos & ringMask];
+        uint64_t key = frameKey(ref.processID, ref.pageNumber);
+        if (lastSeen.find(key) == wrap(pos)) lastSeen.erase(key);
+    }
+
+private:
+    static const uint32_t POSITION_MASK = 0x7FFFFFFF;  // distances stay far below this
+
+    vector<DPT> refs;
+    vector<uint32_t> distance;
+    size_t ringMask = 0;
+    PageTable lastSeen;  // (process, page) -> its latest reference not simulated yet
+
+    static int wrap(size_t pos) { return static_cast<int>(pos & POSITION_MASK); }
+};
+
+const uint32_t LookaheadRing::POSITION_MASK;
+
+// One algorithm's simulator on a streamed trace
+struct StreamRun {
+    unique_ptr<Simulator> sim;
+    function<void(size_t, size_t)> run;           // simulate positions [begin, end)
+    function<void(int, int, size_t)> learnNextUse;  // OPT only
+};
+
+struct SetupStreamRun {
+    StreamRun& stream;
+    const LookaheadRing& ring;
+
+    template <class Policy>
+    void operator()(Policy) const {
+        Simulator* sim = stream.sim.get();
+        const LookaheadRing* refs = &ring;
+        sim->prepare<Policy>();
+        if (Policy::needsNextUse) {
+            for (auto& process : sim->processes) {
+                process.eviction.opt.nextUse = refs->distances();
+                process.eviction.opt.mask = refs->mask();
+            }
+            stream.learnNextUse = [sim](int processID, int pageNumber, size_t next) {
+                sim->learnNextUse<Policy>(processID, pageNumber, next);
+            };
+        }
+        stream.run = [sim, refs](size_t begin, size_t end) {
+            for (size_t pos = begin; pos < end; pos++) sim->runReference<Policy>((*refs)[pos], pos);
+        };
+    }
+};
+
+// Runs every algorithm over a trace read from `source` ("-" for stdin) as
+// it arrives. With OPT-lookahead-X among them a reference is simulated once
+// the X references after it have been read, so OPT sees exactly what it would
+// in a file.
+void simulateStream(const vector<string>& algorithms, const string& source, const Options& options) {
+    FILE* in = source == "-" ? stdin : fopen(source.c_str(), "rb");
+    if (!in) {
+        cerr << "Unable to open trace file!" << endl;
+        exit(1);
+    }
+    ChunkQueue queue(4);
+    thread parser([in, &queue] {
+        TraceStream stream(in);
+        bool more = true;
+        while (more) {
+            vector<DPT> chunk = queue.acquire();
+            more = stream.read(chunk, ChunkQueue::CHUNK);
+            if (chunk.empty()) {
+                queue.release(move(chunk));
+            } else {
+                queue.push(move(chunk));
+            }
+        }
+        queue.close();
+    });
+
+    // Only OPT has to see ahead; everything else is simulated as soon as a
+    // chunk is parsed, so the ring stays one chunk long
+    SimParams params = defaultParams(options);
+    size_t lookahead = 0;
+    for (const string& algorithm : algorithms) {
+        if (needsNextUse(algorithm)) lookahead = static_cast<size_t>(max(0, params.x));
+    }
+    LookaheadRing ring(lookahead + ChunkQueue::CHUNK + 1);
+    vector<StreamRun> runs(algorithms.size());
+    for (size_t i = 0; i < algorithms.size(); i++) {
+        runs[i].sim.reset(new Simulator(processes, TraceView(), params));
+        instrument(*runs[i].sim, options);
+        dispatchPolicy(algorithms[i], SetupStreamRun{runs[i], ring});
+    }
+
+    // The algorithms take each batch in parallel; the ring only changes
+    // between batches
+    ThreadPool pool(workerCount(runs.size()));
+    size_t parsed = 0, simulated = 0;
+    auto simulateUpTo = [&](size_t end) {
+        size_t begin = simulated;
+        for (auto& run : runs) {
+            StreamRun* r = &run;
+            pool.submit([r, begin, end] { r->run(begin, end); });
+        }
+        pool.wait();
+        for (; simulated < end; simulated++) ring.retire(simulated);
+    };
+    vector<DPT> chunk;
+    while (queue.pop(chunk)) {
+        for (const DPT& ref : chunk) {
+            if (!ring.add(ref, parsed)) {
+                for (auto& run : runs) {
+                    if (run.learnNextUse) run.learnNextUse(ref.processID, ref.pageNumber, parsed);
+                }
+            }
+            parsed++;
+        }
+        queue.release(move(chunk));
+        if (parsed > lookahead) simulateUpTo(parsed - lookahead);
+    }
+    simulateUpTo(parsed);
+    parser.join();
+    if (in != stdin) fclose(in);
+
+    if (!options.metricsFormat.empty()) {
+        vector<RunMetrics> metrics;
+        for (size_t i = 0; i < runs.size(); i++) metrics.push_back(runs[i].sim->takeMetrics(algorithms[i]));
+        writeMetrics(metrics, options.metricsFormat);
+        return;
+    }
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (runs.size() > 1) cout << "Running: " << algorithms[i] << "\n";
+        runs[i].sim->report(cout, algorithms[i]);
+    }
+    cout << flush;
+}
+
+// Microbenchmark of the disk request ring: producer threads push `ops`
+// requests between them while one consumer drains them, for 1 to 8
+// producers. Prints CSV.
+void benchDiskRing(size_t ops) {
+    cout << "producers,operations,seconds,mops_per_second\n";
+    for (int producers = 1; producers <= 8; producers *= 2) {
+        DiskRequestRing ring;
+        size_t received = 0;
+        auto start = chrono::steady_clock::now();
+        thread consumer([&ring, &received] {
+            DiskOperation op;
+            while (ring.pop(op)) received++;
+        });
+        vector<thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&ring, ops, producers, p] {
+                DiskOperation op = Simulator::diskRequest(p, 0, DISK_READ);
+                for (size_t i = p; i < ops; i += producers) {
+                    op.pageNumber = static_cast<int32_t>(i);
+                    ring.push(op);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        ring.close();
+        consumer.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << producers << "," << received << "," << seconds << "," << received / seconds / 1e6 << "\n";
+    }
+}
+
+// Synthetic workloads for --bench and --generate. The generators run off
+// their own seeded SplitMix64, so a (workload, refs, seed) triple gives the
+// same trace on every machine.
+struct SplitMix64 {
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t x = (state += 0x9E3779B97F4A7C15ULL);
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+    int below(int n) { return static_cast<int>(next() % n); }
+    double unit() { return (next() >> 11) * (1.0 / (1ULL << 53)); }
+};
+
+enum WorkloadKind { WORKLOAD_ZIPF, WORKLOAD_SEQUENTIAL, WORKLOAD_LOOPING, WORKLOAD_PHASED, WORKLOAD_MIXED };
+const char* const workloadNames[] = {"zipf", "sequential", "looping", "phased", "mixed"};
+const int WORKLOAD_COUNT = 5;
+
+struct WorkloadShape {
+    int processes = 4;
+    int frames = 64;           // per process, in the --bench config
+    int pages = 4096;          // distinct pages per process
+    double zipfSkew = 0.99;
+    int loopLength = 80;       // looping: a bit more than the frames, the LRU worst case
+    int phaseLength = 50000;   // phased: references before the working set moves
+    int workingSet = 48;       // phased: pages in the working set
+};
+
+// One process's page references. Mixed workloads give every process a
+// different kind of stream.
+class PageStream {
+public:
+    PageStream(WorkloadKind k, const WorkloadShape& s, const vector<double>& cdf, uint64_t seed)
+        : kind(k), shape(s), zipfCdf(cdf), rng(seed) {}
+
+    int next() {
+        switch (kind) {
+        case WORKLOAD_ZIPF:
+            // Page rank by inverse CDF; page 0 is the hottest
+            return static_cast<int>(lower_bound(zipfCdf.begin(), zipfCdf.end(), rng.unit()) - zipfCdf.begin());
+        case WORKLOAD_SEQUENTIAL:
+            return static_cast<int>(position++ % shape.pages);
+        case WORKLOAD_LOOPING:
+            return static_cast<int>(position++ % shape.loopLength);
+        default:  // WORKLOAD_PHASED
+            if (position++ % shape.phaseLength == 0) base = rng.below(shape.pages - shape.workingSet);
+            return base + rng.below(shape.workingSet);
+        }
+    }
+
+private:
+    WorkloadKind kind;
+    const WorkloadShape& shape;
+    const vector<double>& zipfCdf;
+    SplitMix64 rng;
+    uint64_t position = 0;
+    int base = 0;
+};
+
+// refs references from shape.processes processes, interleaved at random
+vector<DPT> generateWorkload(WorkloadKind kind, const WorkloadShape& shape, size_t refs, uint64_t seed) {
+    vector<double> zipfCdf(shape.pages);
+    double sum = 0;
+    for (int r = 0; r < shape.pages; r++) {
+        sum += 1.0 / pow(r + 1.0, shape.zipfSkew);
+        zipfCdf[r] = sum;
+    }
+    for (auto& c : zipfCdf) c /= sum;
+    zipfCdf.back() = 1.0;
+
+    SplitMix64 rng(seed);
+    vector<PageStream> streams;
+    for (int p = 0; p < shape.processes; p++) {
+        WorkloadKind own = kind == WORKLOAD_MIXED ? static_cast<WorkloadKind>(p % WORKLOAD_MIXED) : kind;
+        streams.push_back(PageStream(own, shape, zipfCdf, rng.next()));
+    }
+    vector<DPT> out(refs);
+    for (size_t t = 0; t < refs; t++) {
+        int p = rng.below(shape.processes);
+        out[t].processID = p;
+        out[t].pageNumber = streams[p].next();
+        out[t].time = static_cast<int>(t);
+    }
+    return out;
+}
+
+bool parseWorkload(const string& name, WorkloadKind& kind) {
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        if (name == workloadNames[w]) {
+            kind = static_cast<WorkloadKind>(w);
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeBinaryTrace(const string& path, const vector<DPT>& refs) {
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        cerr << "Unable to create " << path << endl;
+        exit(1);
+    }
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(DPT);
+    header.count = refs.size();
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(refs.data(), sizeof(DPT), refs.size(), out);
+    if (fclose(out) != 0) {
+        cerr << "Failed writing " << path << endl;
+        exit(1);
+    }
+}
+
+static long peakMemoryKB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Runs every policy over every synthetic workload on a fixed config
+// (WorkloadShape's processes and frames, OPT window 1000) and prints one CSV
+// row per run. Peak memory is the process's high-water mark so far, so it
+// only ever grows down the table.
+void runBenchmark(size_t refs, uint64_t seed) {
+    WorkloadShape shape;
+    processes.clear();
+    for (int p = 0; p < shape.processes; p++) {
+        processes.push_back(Process(p, shape.frames));
+    }
+    g_nX = 1000;
+
+    cout << "workload,algorithm,references,faults,seconds,refs_per_second,faults_per_second,ns_per_fault,peak_memory_kb\n";
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        vector<DPT> refsOfWorkload = generateWorkload(static_cast<WorkloadKind>(w), shape, refs, seed);
+        trace.entries = refsOfWorkload.data();
+        trace.count = refsOfWorkload.size();
+        nextUseTrace = TraceView();  // new trace, the next-use index is stale
+
+        for (const auto& alg : allAlgorithms) {
+            auto start = chrono::steady_clock::now();
+            if (needsNextUse(alg)) buildNextUseIndex();  // part of OPT's cost
+            Simulator sim(processes, trace, defaultParams());
+            sim.runSimulation(alg);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            uint64_t faults = sim.totalFaults();
+            cout << workloadNames[w] << "," << alg << "," << refs << "," << faults << "," << seconds << ","
+                 << refs / seconds << "," << faults / seconds << ","
+                 << (faults ? seconds * 1e9 / faults : 0) << "," << peakMemoryKB() << "\n";
+        }
+    }
+    trace = TraceView();
+    cout << flush;
+}
+
+// Parameter sweeps (SWEEP mode). Every combination of the given ranges is
+// simulated in one run. All configurations of a policy form a batch that
+// walks the trace together in small chunks, so each chunk is decoded once
+// and stays in cache while every simulator in the batch replays it. The
+// batches of different policies run in parallel.
+const size_t SWEEP_CHUNK = 65536; // references, ~768KB of trace
+
+struct SweepRow {
+    string algorithm;
+    SimParams params;
+    bool usesX, usesK, usesWindow;
+    uint64_t faults;
+};
+
+struct RunSweepBatch {
+    vector<SweepRow*>& rows;
+
+    template <class Policy>
+    void operator()(Policy) const {
+        vector<unique_ptr<Simulator>> sims;
+        for (SweepRow* row : rows) {
+            sims.emplace_back(new Simulator(processes, trace, row->params));
+            sims.back()->prepare<Policy>();
+        }
+        for (size_t begin = 0; begin < trace.size(); begin += SWEEP_CHUNK) {
+            size_t end = min(trace.size(), begin + SWEEP_CHUNK);
+            for (auto& sim : sims) sim->runRange<Policy>(begin, end);
+        }
+        for (size_t i = 0; i < rows.size(); i++) {
+            rows[i]->faults = sims[i]->totalFaults();
+        }
+    }
+};
+
+// Expands the ranges for one policy, skipping parameters it never reads so
+// configurations that could only differ there are simulated once
+struct ExpandSweep {
+    const string& algorithm;
+    const Options& options;
+    vector<SweepRow>& rows;
+
+    template <class Policy>
+    void operator()(Policy) const {
+        SimParams base = defaultParams(options);
+        vector<int> xs = Policy::usesX && !options.sweepX.empty() ? options.sweepX : vector<int>(1, base.x);
+        vector<int> ks = Policy::usesK && !options.sweepK.empty() ? options.sweepK : vector<int>(1, base.k);
+        vector<int> windows = Policy::usesWindow && !options.sweepWindow.empty() ? options.sweepWindow
+                                                                                   : vector<int>(1, base.wsWindow);
+        vector<int> frames = !options.sweepFrames.empty() ? options.sweepFrames : vector<int>(1, base.frames);
+        for (int f : frames) {
+            for (int x : xs) {
+                for (int k : ks) {
+                    for (int w : windows) {
+                        SweepRow row;
+                        row.algorithm = algorithm;
+                        row.params = base;
+                        row.params.frames = f;
+                        row.params.x = x;
+                        row.params.k = k;
+                        row.params.wsWindow = w;
+                        row.usesX = Policy::usesX;
+                        row.usesK = Policy::usesK;
+                        row.usesWindow = Policy::usesWindow;
+                        row.faults = 0;
+                        rows.push_back(row);
+                    }
+                }
+            }
+        }
+    }
+};
+
+void runSweep(const vector<string>& algorithms, const Options& options) {
+    vector<SweepRow> rows;
+    for (const auto& alg : algorithms) {
+        dispatchPolicy(alg, ExpandSweep{alg, options, rows});
+    }
+    prepareTrace(algorithms, options);
+
+    vector<vector<SweepRow*>> batches(algorithms.size());
+    for (auto& row : rows) {
+        size_t b = find(algorithms.begin(), algorithms.end(), row.algorithm) - algorithms.begin();
+        batches[b].push_back(&row);
+    }
+    {
+        ThreadPool pool(workerCount(batches.size()));
+        for (size_t b = 0; b < batches.size(); b++) {
+            vector<SweepRow*>* batch = &batches[b];
+            const string* alg = &algorithms[b];
+            pool.submit([batch, alg] { dispatchPolicy(*alg, RunSweepBatch{*batch}); });
+        }
+        pool.wait();
+    }
+
+    uint64_t references = 0;
+    ProcessIndex slotOf(processes);
+    for (const DPT& line : trace) {
+        if (slotOf(line.processID) >= 0) references++;
+    }
+
+    ostringstream out;
+    out << "algorithm,frames,x,k,ws_window,references,faults,miss_ratio\n";
+    for (const auto& row : rows) {
+        out << row.algorithm << ",";
+        if (row.params.frames > 0) out << row.params.frames; else out << "config";
+        out << ",";
+        if (row.usesX) out << row.params.x; else out << "-";
+        out << ",";
+        if (row.usesK) out << row.params.k; else out << "-";
+        out << ",";
+        if (row.usesWindow) out << row.params.wsWindow; else out << "-";
+        out << "," << references << "," << row.faults << ","
+            << (references ? static_cast<double>(row.faults) / references : 0) << "\n";
+    }
+    cout << out.str() << flush;
+}
+
+// Parses "5", "1,2,4", "10:100" or "10:100:10" (inclusive), or a comma
+// separated mix of them
+vector<int> parseRange(const string& text) {
+    vector<int> values;
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ',')) {
+        int from, to, step = 1;
+        char sep1, sep2;
+        stringstream in(item);
+        if (!(in >> from)) {
+            cerr << "Invalid range: " << text << endl;
+            exit(1);
+        }
+        to = from;
+        if (in >> sep1) {
+            if (sep1 != ':' || !(in >> to) || ((in >> sep2) && (sep2 != ':' || !(in >> step))) || step <= 0) {
+                cerr << "Invalid range: " << text << endl;
+                exit(1);
+            }
+        }
+        for (int64_t v = from; v <= to; v += step) values.push_back(static_cast<int>(v));  // no overflow near INT_MAX
+    }
+    if (values.empty()) {
+        cerr << "Empty range: " << text << endl;
+        exit(1);
+    }
+    return values;
+}
+
+vector<string> splitList(const string& text) {
+    vector<string> items;
+    stringstream in(text);
+    string item;
+    while (getline(in, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+// Global replacement (GLOBAL mode): one fixed pool of physical frames shared
+// by every process instead of a private resident set each. The inverted
+// page table maps (processID, pageNumber) to the frame holding it, and a
+// fault with the pool full takes its victim from whichever process the
+// policy picks. Frames never move, so the policy structures are indexed by
+// frame and every reference is O(1) (amortized for CLOCK's hand).
+struct FramePool {
+    struct Frame {
+        int slot;  // owning process's index, -1 while free
+        int processID;
+        int pageNumber;
+    };
+
+    vector<Frame> frames;
+    size_t used = 0;
+    PageTable inverted;            // frameKey(processID, pageNumber) -> frame
+    vector<size_t> occupancy;      // frames held, per process slot
+    vector<uint64_t> faults;       // per process slot
+    // Victim selection; only the running policy's structure is used
+    SlotList lru;                  // most recently used at the front
+    vector<uint8_t> referenced;    // CLOCK reference bits
+    size_t hand = 0;
+    FrequencyHeap lfu;
+
+    FramePool(size_t frameCount, size_t processCount)
+        : frames(frameCount, Frame{-1, 0, 0}), occupancy(processCount, 0), faults(processCount, 0),
+          referenced(frameCount, 0) {
+        inverted.reserve(frameCount);
+    }
+};
+
+struct GlobalLRU {
+    static const char* name() { return "LRU"; }
+    static void onInsert(FramePool& pool, int frame) { pool.lru.pushFront(frame); }
+    static void onHit(FramePool& pool, int frame) { pool.lru.moveToFront(frame); }
+    static int victim(FramePool& pool) {
+        int frame = pool.lru.back();
+        pool.lru.erase(frame);
+        return frame;
+    }
+};
+
+// Second chance: the hand clears reference bits until it finds a frame
+// that wasn't used since the last sweep
+struct GlobalClock {
+    static const char* name() { return "CLOCK"; }
+    static void onInsert(FramePool& pool, int frame) { pool.referenced[frame] = 1; }
+    static void onHit(FramePool& pool, int frame) { pool.referenced[frame] = 1; }
+    static int victim(FramePool& pool) {
+        size_t n = pool.frames.size();
+        while (pool.referenced[pool.hand]) {
+            pool.referenced[pool.hand] = 0;
+            pool.hand = (pool.hand + 1) % n;
+        }
+        int frame = static_cast<int>(pool.hand);
+        pool.hand = (pool.hand + 1) % n;
+        return frame;
+    }
+};
+
+struct GlobalLFU {
+    static const char* name() { return "LFU"; }
+    static void onInsert(FramePool& pool, int frame) { pool.lfu.insert(frame, 1); }
+    static void onHit(FramePool& pool, int frame) { pool.lfu.touch(frame); }
+    static int victim(FramePool& pool) {
+        int frame = pool.lfu.victim();
+        pool.lfu.erase(frame);
+        return frame;
+    }
+};
+
+// One global-replacement run. occupancy gets the frames held by every
+// process after each sampleEvery references.
+template <class Policy>
+void runGlobal(FramePool& pool, size_t sampleEvery, vector<vector<size_t>>& occupancy) {
+    ProcessIndex slotOf(processes);
+    for (size_t i = 0; i < trace.size(); i++) {
+        const DPT& line = trace[i];
+        int slot = slotOf(line.processID);
+        if (slot >= 0) {
+            uint64_t key = frameKey(line.processID, line.pageNumber);
+            int frame = pool.inverted.find(key);
+            if (frame != PageTable::NOT_FOUND) {
+                Policy::onHit(pool, frame);
+            } else {
+                pool.faults[slot]++;
+                if (pool.used < pool.frames.size()) {
+                    frame = static_cast<int>(pool.used++);
+                } else {
+                    frame = Policy::victim(pool);
+                    const FramePool::Frame& old = pool.frames[frame];
+                    pool.inverted.erase(frameKey(old.processID, old.pageNumber));
+                    pool.occupancy[old.slot]--;
+                }
+                pool.frames[frame] = FramePool::Frame{slot, line.processID, line.pageNumber};
+                pool.inverted.set(key, frame);
+                pool.occupancy[slot]++;
+                Policy::onInsert(pool, frame);
+            }
+        }
+        if ((i + 1) % sampleEvery == 0 || i + 1 == trace.size()) occupancy.push_back(pool.occupancy);
+    }
+}
+
+template <class F>
+bool dispatchGlobalPolicy(const string& name, F f) {
+    if (name == GlobalLRU::name()) f(GlobalLRU());
+    else if (name == GlobalClock::name()) f(GlobalClock());
+    else if (name == GlobalLFU::name()) f(GlobalLFU());
+    else return false;
+    return true;
+}
+
+struct RunGlobal {
+    FramePool& pool;
+    size_t sampleEvery;
+    vector<vector<size_t>>& occupancy;
+    template <class Policy>
+    void operator()(Policy) const { runGlobal<Policy>(pool, sampleEvery, occupancy); }
+};
+
+// GLOBAL mode: every given policy on its own pool, in parallel. The pool
+// defaults to the sum of the processes' frame counts from the config.
+void simulateGlobal(const vector<string>& policies, const Options& options) {
+    if (!traceLoaded && trace.empty()) generateRandomTrace();
+    size_t poolFrames = options.poolFrames;
+    if (poolFrames == 0) {
+        for (const auto& process : processes) poolFrames += max(process.size, 0);
+    }
+    if (poolFrames == 0) {
+        cout << "The frame pool is empty." << endl;
+        return;
+    }
+    size_t sampleEvery = options.occupancyEvery ? options.occupancyEvery : max<size_t>(1, trace.size() / 20);
+
+    vector<ostringstream> reports(policies.size());
+    {
+        ThreadPool workers(workerCount(policies.size()));
+        for (size_t p = 0; p < policies.size(); p++) {
+            workers.submit([p, &policies, &reports, poolFrames, sampleEvery] {
+                FramePool pool(poolFrames, processes.size());
+                vector<vector<size_t>> occupancy;
+                dispatchGlobalPolicy(policies[p], RunGlobal{pool, sampleEvery, occupancy});
+
+                ostream& out = reports[p];
+                uint64_t total = 0;
+                for (size_t s = 0; s < processes.size(); s++) {
+                    out << "Process ID: " << processes[s].id << " - Page Faults: " << pool.faults[s] << "\n";
+                    total += pool.faults[s];
+                }
+                out << "Total Page Faults: " << total << "\n";
+                out << "Frame Occupancy (frames held per process):\nreference";
+                for (const auto& process : processes) out << "," << process.id;
+                out << "\n";
+                for (size_t t = 0; t < occupancy.size(); t++) {
+                    out << min((t + 1) * sampleEvery, trace.size());
+                    for (size_t held : occupancy[t]) out << "," << held;
+                    out << "\n";
+                }
+            });
+        }
+        workers.wait();
+    }
+    for (size_t p = 0; p < policies.size(); p++) {
+        cout << "Running: GLOBAL-" << policies[p] << " (" << poolFrames << " frames)\n" << reports[p].str();
+    }
+    cout << flush;
+}
+
+// Miss-ratio curves (MRC mode). Instead of one simulation per frame count,
+// every reference's stack distance is measured once: under LRU and OPT a
+// reference hits with c frames exactly when its distance is <= c (Mattson's
+// inclusion property), so a histogram of distances gives the fault count for
+// every c at once.
+
+// LRU stack distances: a Fenwick tree over access timestamps with a 1 at each
+// page's latest access, so the distance of a re-reference is the number of
+// marks after its previous access. Timestamps are compacted when the tree
+// fills, keeping memory proportional to the pages tracked, not the trace.
+class StackDistanceTree {
+public:
+    // Records an access to `page`; returns its stack distance, 0 if cold
+    uint64_t access(int page) {
+        uint64_t distance = 0;
+        int last = lastAccess.find(pageKey(page));
+        if (last != PageTable::NOT_FOUND) {
+            distance = static_cast<uint64_t>(live - prefix(last));  // marks in [last, now), itself included
+            add(last, -1);
+            owner[last] = EMPTY;
+            live--;
+        }
+        if (now == static_cast<int>(owner.size())) compact();
+        owner[now] = page;
+        add(now, 1);
+        lastAccess.set(pageKey(page), now);
+        now++;
+        live++;
+        return distance;
+    }
+
+    // Drops `page` as if it had never been seen (SHARDS sample eviction)
+    void forget(int page) {
+        int last = lastAccess.find(pageKey(page));
+        if (last == PageTable::NOT_FOUND) return;
+        add(last, -1);
+        owner[last] = EMPTY;
+        lastAccess.erase(pageKey(page));
+        live--;
+    }
+
+private:
+    static const int EMPTY = INT_MIN;
+
+    vector<int> tree;   // Fenwick tree, 1-based
+    vector<int> owner;  // timestamp -> page last accessed then, EMPTY if stale
+    PageTable lastAccess;
+    int now = 0;
+    int live = 0;
+
+    int prefix(int t) const {  // marks at timestamps < t
+        int sum = 0;
+        for (int i = t; i > 0; i -= i & -i) sum += tree[i];
+        return sum;
+    }
+
+    void add(int t, int delta) {
+        for (int i = t + 1; i < static_cast<int>(tree.size()); i += i & -i) tree[i] += delta;
+    }
+
+    // Renumbers the live timestamps 0..live-1 and doubles the room if needed
+    void compact() {
+        size_t capacity = max<size_t>(64, static_cast<size_t>(live) * 2);
+        vector<int> pages;
+        pages.reserve(live);
+        for (int t = 0; t < now; t++) {
+            if (owner[t] != EMPTY) pages.push_back(owner[t]);
+        }
+        owner.assign(capacity, EMPTY);
+        tree.assign(capacity + 1, 0);
+        for (size_t t = 0; t < pages.size(); t++) {
+            owner[t] = pages[t];
+            lastAccess.set(pageKey(pages[t]), static_cast<int>(t));
+            tree[t + 1] = 1;
+        }
+        for (size_t i = 1; i < tree.size(); i++) {  // O(n) Fenwick build
+            size_t parent = i + (i & (~i + 1));
+            if (parent < tree.size()) tree[parent] += tree[i];
+        }
+        now = static_cast<int>(pages.size());
+    }
+};
+
+const int StackDistanceTree::EMPTY;
+
+// Mattson's OPT stack, optionally truncated to the top `depth` entries. On a
+// reference the page goes to the top and, level by level, the page with the
+// farther next use is pushed down until the page's old slot is reached. That
+// is O(distance) per reference, bounded by --mrc-frames.
+class OptStack {
+public:
+    explicit OptStack(size_t maxDepth) : depth(maxDepth) {}
+
+    // Records a reference to `page` whose next use is `next`; returns its
+    // stack distance, 0 if cold or deeper than the stack keeps
+    uint64_t access(int page, uint32_t next) {
+        Entry carry = {page, next};
+        for (size_t i = 0; i < stack.size(); i++) {
+            if (stack[i].page == page) {
+                stack[i] = carry;
+                return i + 1;
+            }
+            if (i == 0 || stack[i].next > carry.next) {
+                swap(stack[i], carry);
+            }
+        }
+        if (stack.size() < depth) stack.push_back(carry);
+        return 0;
+    }
+
+private:
+    struct Entry {
+        int page;
+        uint32_t next;
+    };
+
+    vector<Entry> stack;
+    size_t depth;
+};
+
+// Distance histogram of one process; far counts cold misses and distances
+// beyond what is tracked
+struct DistanceHistogram {
+    vector<double> counts;  // counts[d] = references at distance d
+    double far = 0;
+
+    void record(uint64_t distance, size_t limit) {
+        if (distance == 0 || (limit && distance > limit)) {
+            far += 1;
+            return;
+        }
+        if (distance >= counts.size()) counts.resize(distance + 1, 0);
+        counts[distance] += 1;
+    }
+
+    void scale(double factor) {
+        for (auto& c : counts) c *= factor;
+        far *= factor;
+    }
+
+    double total() const {
+        double sum = far;
+        for (double c : counts) sum += c;
+        return sum;
+    }
+
+    // faults[c] for c = 0..frames
+    vector<double> faultCurve(size_t frames) const {
+        vector<double> faults(frames + 1, 0);
+        double misses = total();
+        for (size_t c = 0; c <= frames; c++) {
+            if (c > 0 && c < counts.size()) misses -= counts[c];
+            faults[c] = misses;
+        }
+        return faults;
+    }
+};
+
+// SHARDS spatial sampling (Waldspurger et al., FAST '15): only pages whose
+// hash falls under a threshold are tracked, and their distances are scaled
+// up by 1/rate. With a cap on sampled pages the threshold is lowered to
+// evict the largest-hash page, which keeps memory constant.
+struct ShardsSampler {
+    static const uint64_t MODULUS = 1ULL << 24;
+
+    uint64_t threshold = MODULUS;
+    size_t maxPages = 0;
+    priority_queue<pair<uint64_t, int>> sampled;  // (hash, page), largest hash on top
+    PageTable members;
+
+    static uint64_t hash(int page) {
+        uint64_t x = static_cast<uint32_t>(page) + 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return (x ^ (x >> 31)) % MODULUS;
+    }
+
+    double rate() const { return static_cast<double>(threshold) / MODULUS; }
+};
+
+const uint64_t ShardsSampler::MODULUS;
+
+struct ProcessCurve {
+    uint64_t references = 0;
+    StackDistanceTree lru;
+    OptStack opt;
+    DistanceHistogram lruDistances, optDistances;
+    ShardsSampler shards;
+
+    explicit ProcessCurve(size_t depth) : opt(depth ? depth : SIZE_MAX) {}
+};
+
+// MRC mode: one pass over the trace, then a CSV with LRU and OPT fault counts
+// for every frame count, per process and summed over all processes (every
+// process given the same number of frames). With --shards only the LRU
+// curve is estimated, from a sample of the pages.
+void analyzeMissRatio(const Options& options) {
+    bool sampling = options.shardsRate > 0;
+    if (!sampling) buildNextUseIndex();
+
+    ProcessIndex slotOf(processes);
+    vector<ProcessCurve> curves;
+    curves.reserve(processes.size());
+    for (size_t i = 0; i < processes.size(); i++) {
+        curves.emplace_back(options.mrcFrames);
+        curves.back().shards.threshold = static_cast<uint64_t>(min(1.0, options.shardsRate) * ShardsSampler::MODULUS);
+        curves.back().shards.maxPages = options.shardsMax;
+    }
+
+    for (size_t i = 0; i < trace.size(); i++) {
+        int slot = slotOf(trace[i].processID);
+        if (slot < 0) continue;
+        ProcessCurve& pc = curves[slot];
+        int page = trace[i].pageNumber;
+        pc.references++;
+
+        if (!sampling) {
+            pc.lruDistances.record(pc.lru.access(page), options.mrcFrames);
+            uint32_t next = nextUse[i] == LookaheadIndex::NEVER ? nextUse[i] : static_cast<uint32_t>(i + nextUse[i]);
+            pc.optDistances.record(pc.opt.access(page, next), options.mrcFrames);
+            continue;
+        }
+
+        ShardsSampler& sh = pc.shards;
+        uint64_t h = ShardsSampler::hash(page);
+        if (h >= sh.threshold) continue;
+        if (sh.members.find(pageKey(page)) == PageTable::NOT_FOUND) {
+            sh.members.set(pageKey(page), 1);
+            sh.sampled.push(make_pair(h, page));
+        }
+        uint64_t distance = pc.lru.access(page);
+        pc.lruDistances.record(distance ? static_cast<uint64_t>(distance / sh.rate() + 0.5) : 0, options.mrcFrames);
+
+        // Over the cap: lower the threshold past the largest sampled hash
+        while (sh.maxPages && sh.sampled.size() > sh.maxPages) {
+            double oldRate = sh.rate();
+            sh.threshold = sh.sampled.top().first;
+            while (!sh.sampled.empty() && sh.sampled.top().first >= sh.threshold) {
+                pc.lru.forget(sh.sampled.top().second);
+                sh.members.erase(pageKey(sh.sampled.top().second));
+                sh.sampled.pop();
+            }
+            pc.lruDistances.scale(sh.rate() / oldRate);
+        }
+    }
+
+    // Largest frame count shown: the cap, or the deepest distance seen
+    size_t frames = options.mrcFrames;
+    if (!frames) {
+        for (const auto& pc : curves) {
+            frames = max(frames, max(pc.lruDistances.counts.size(), pc.optDistances.counts.size()));
+        }
+        frames = max<size_t>(frames, 2) - 1;
+    }
+
+    ostringstream out;
+    out << "process,frames,references,lru_faults,lru_miss_ratio,opt_faults,opt_miss_ratio\n";
+    uint64_t totalRefs = 0;
+    vector<double> totalLru(frames + 1, 0), totalOpt(frames + 1, 0);
+    for (size_t p = 0; p < curves.size(); p++) {
+        ProcessCurve& pc = curves[p];
+        totalRefs += pc.references;
+        if (!pc.references) continue;
+        // SHARDS histograms count sampled references; normalise to the real count
+        double weight = sampling ? pc.references / max(pc.lruDistances.total(), 1.0) : 1.0;
+        vector<double> lru = pc.lruDistances.faultCurve(frames);
+        vector<double> opt = pc.optDistances.faultCurve(frames);
+        for (size_t c = 1; c <= frames; c++) {
+            double lruFaults = lru[c] * weight;
+            totalLru[c] += lruFaults;
+            totalOpt[c] += opt[c];
+            out << processes[p].id << "," << c << "," << pc.references << ","
+                << static_cast<uint64_t>(lruFaults + 0.5) << "," << lruFaults / pc.references << ",";
+            if (sampling) {
+                out << ",\n";
+            } else {
+                out << static_cast<uint64_t>(opt[c]) << "," << opt[c] / pc.references << "\n";
+            }
+        }
+    }
+    for (size_t c = 1; c <= frames && totalRefs; c++) {
+        out << "ALL," << c << "," << totalRefs << "," << static_cast<uint64_t>(totalLru[c] + 0.5) << ","
+            << totalLru[c] / totalRefs << ",";
+        if (sampling) {
+            out << ",\n";
+        } else {
+            out << static_cast<uint64_t>(totalOpt[c]) << "," << totalOpt[c] / totalRefs << "\n";
+        }
+    }
+    cout << out.str() << flush;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && string(argv[1]) == "--convert") {
+        convertTrace(argv[2], argv[3]);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench") {
+        runBenchmark(argc >= 3 ? strtoull(argv[2], nullptr, 10) : 2000000,
+                     argc >= 4 ? strtoull(argv[3], nullptr, 10) : 42);
+        return 0;
+    }
+    if (argc >= 4 && string(argv[1]) == "--generate") {
+        WorkloadKind kind;
+        if (!parseWorkload(argv[2], kind)) {
+            cout << "Unknown workload: " << argv[2] << ". Use zipf, sequential, looping, phased or mixed." << endl;
+            return 1;
+        }
+        size_t refs = argc >= 5 ? strtoull(argv[4], nullptr, 10) : 1000000;
+        writeBinaryTrace(argv[3], generateWorkload(kind, WorkloadShape(), refs,
+                                                   argc >= 6 ? strtoull(argv[5], nullptr, 10) : 42));
+        cout << "Wrote " << refs << " references to " << argv[3] << endl;
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "--bench-ring") {
+        benchDiskRing(argc >= 3 ? strtoul(argv[2], nullptr, 10) : 10000000);
+        return 0;
+    }
+
+    Options options;
+    vector<string> args;
+    bool badOption = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--parallel") {
+            options.parallel = true;
+        } else if (arg == "--disk") {
+            options.diskTiming = true;
+        } else if (arg == "--metrics" && hasValue) {
+            options.metricsFormat = argv[++i];
+            if (options.metricsFormat != "json" && options.metricsFormat != "csv") badOption = true;
+        } else if (arg == "--pool" && hasValue) {
+            options.poolFrames = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--occupancy-every" && hasValue) {
+            options.occupancyEvery = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--global-policy" && hasValue) {
+            options.globalPolicies = splitList(argv[++i]);
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--stream") {
+            options.stream = true;
+        } else if (arg == "--disk-sched" && hasValue) {
+            options.diskTiming = true;
+            options.diskSchedulers = splitList(argv[++i]);
+        } else if (arg == "--mrc-frames" && hasValue) {
+            options.mrcFrames = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--shards" && hasValue) {
+            options.shardsRate = atof(argv[++i]);
+        } else if (arg == "--shards-max" && hasValue) {
+            options.shardsMax = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--x" && hasValue) {
+            options.sweepX = parseRange(argv[++i]);
+        } else if (arg == "--k" && hasValue) {
+            options.sweepK = parseRange(argv[++i]);
+        } else if (arg == "--ws-window" && hasValue) {
+            options.sweepWindow = parseRange(argv[++i]);
+        } else if (arg == "--crp" && hasValue) {
+            options.correlatedPeriod = atoi(argv[++i]);
+        } else if (arg == "--ws-timeline" && hasValue) {
+            options.wsTimeline = atoi(argv[++i]);
+        } else if (arg == "--readahead" && hasValue) {
+            string mode = argv[++i];
+            if (mode == "sequential") options.readAhead = READAHEAD_SEQUENTIAL;
+            else if (mode == "stride") options.readAhead = READAHEAD_STRIDE;
+            else if (mode == "adaptive") options.readAhead = READAHEAD_ADAPTIVE;
+            else badOption = true;
+        } else if (arg == "--readahead-pages" && hasValue) {
+            options.readAheadPages = max(atoi(argv[++i]), 1);
+        } else if (arg == "--write-ratio" && hasValue) {
+            options.writeRatio = min(max(atof(argv[++i]), 0.0), 1.0);
+        } else if (arg == "--io-batch" && hasValue) {
+            options.ioBatch = max(atoi(argv[++i]), 1);
+        } else if (arg == "--checkpoint" && hasValue) {
+            options.checkpointPath = argv[++i];
+        } else if (arg == "--checkpoint-at" && hasValue) {
+            options.checkpointAt = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--resume" && hasValue) {
+            options.resumeFrom = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            options.sweepFrames = parseRange(argv[++i]);
+        } else if (arg == "--algorithms" && hasValue) {
+            options.sweepAlgorithms = splitList(argv[++i]);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            badOption = true;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (badOption || (args.size() != 2 && args.size() != 3)) {
+        cout << "Usage: " << argv[0] << " <config_file> <algorithm> [trace_file] [--parallel] [--disk] [--disk-sched S,T|ALL]\n";
+        cout << "           [--stream] [--metrics json|csv] [--verbose] [--k K] [--crp P] [--ws-window W] [--ws-timeline N]\n";
+        cout << "           [--readahead sequential|stride|adaptive] [--readahead-pages N] [--write-ratio R] [--io-batch N]\n";
+        cout << "           [--checkpoint FILE --checkpoint-at N] [--resume FILE]\n";
+        cout << "       " << argv[0] << " <config_file> MRC [trace_file] [--mrc-frames N] [--shards RATE] [--shards-max N]\n";
+        cout << "       " << argv[0] << " <config_file> GLOBAL [trace_file] [--pool N] [--global-policy LRU,CLOCK,LFU] [--occupancy-every N]\n";
+        cout << "       " << argv[0] << " <config_file> SWEEP [trace_file] [--x R] [--k R] [--ws-window R] [--frames R] [--algorithms A,B]\n";
+        cout << "       " << argv[0] << " --convert <text_trace> <binary_trace>\n";
+        cout << "       " << argv[0] << " --generate <zipf|sequential|looping|phased|mixed> <binary_trace> [refs] [seed]\n";
+        cout << "       " << argv[0] << " --bench [refs] [seed]\n";
+        cout << "       " << argv[0] << " --bench-ring [operations]\n";
+        return 1;
+    }
+
+    string config_file = args[0];
+    string algorithm = args[1];
+
+    readFile(config_file); // Load data
+    options.stream = options.stream || (args.size() == 3 && args[2] == "-");
+    if (!options.checkpointPath.empty() || !options.resumeFrom.empty()) {
+        bool plainRun = algorithm == "ALL" || find(allAlgorithms.begin(), allAlgorithms.end(), algorithm) != allAlgorithms.end();
+        bool oneRun = algorithm != "ALL" || options.checkpointPath.empty();
+        bool positioned = options.checkpointPath.empty() || options.checkpointAt != SIZE_MAX;
+        if (!plainRun || !oneRun || !positioned || options.stream || options.parallel || options.diskTiming) {
+            cout << "Checkpoints need an algorithm (or ALL, to resume only) and --checkpoint-at with --checkpoint, "
+                    "without --stream, --parallel or --disk." << endl;
+            return 1;
+        }
+    }
+    if (options.stream) {
+        bool plainRun = algorithm == "ALL" || find(allAlgorithms.begin(), allAlgorithms.end(), algorithm) != allAlgorithms.end();
+        if (args.size() != 3 || !plainRun || options.parallel || options.diskTiming) {
+            cout << "Streaming needs a trace (\"-\" for stdin) and an algorithm or ALL, without --parallel or --disk." << endl;
+            return 1;
+        }
+        simulateStream(algorithm == "ALL" ? allAlgorithms : vector<string>(1, algorithm), args[2], options);
+        return 0;
+    }
+    if (args.size() == 3) {
+        loadTrace(args[2]); // Text or binary, detected from the header
+    }
+
+
+    if (options.diskSchedulers.size() == 1 && options.diskSchedulers[0] == "ALL") {
+        options.diskSchedulers.clear();
+        for (int p = DiskScheduler::FIFO; p <= DiskScheduler::CLOOK; p++) {
+            options.diskSchedulers.push_back(DiskScheduler::name(static_cast<DiskScheduler::Policy>(p)));
+        }
+    }
+    for (const auto& sched : options.diskSchedulers) {
+        DiskScheduler::Policy policy;
+        if (!DiskScheduler::parse(sched, policy)) {
+            cout << "Invalid disk scheduler: " << sched << ". Use FIFO, SSTF, SCAN, C-SCAN, LOOK, C-LOOK or ALL." << endl;
+            return 1;
+        }
+    }
+
+    if (algorithm == "MRC") {
+        if (!traceLoaded) generateRandomTrace();
+        analyzeMissRatio(options);
+    } else if (algorithm == "GLOBAL") {
+        vector<string> policies = options.globalPolicies;
+        if (policies.empty()) policies = {"LRU", "CLOCK", "LFU"};
+        for (const auto& policy : policies) {
+            if (policy != "LRU" && policy != "CLOCK" && policy != "LFU") {
+                cout << "Invalid global policy: " << policy << ". Use LRU, CLOCK or LFU." << endl;
+                return 1;
+            }
+        }
+        simulateGlobal(policies, options);
+    } else if (algorithm == "SWEEP") {
+        vector<string> sweepAlgorithms = options.sweepAlgorithms.empty() ? allAlgorithms : options.sweepAlgorithms;
+        for (const auto& alg : sweepAlgorithms) {
+            if (find(allAlgorithms.begin(), allAlgorithms.end(), alg) == allAlgorithms.end()) {
+                cout << "Invalid algorithm in --algorithms: " << alg << endl;
+                return 1;
+            }
+        }
+        runSweep(sweepAlgorithms, options);
+    } else if (algorithm == "ALL") {
+        simulateAll(allAlgorithms, options);
+    } else if (find(allAlgorithms.begin(), allAlgorithms.end(), algorithm) != allAlgorithms.end()) {
+        simulate(algorithm, options);
+    } else {
+        cout << "Invalid algorithm. Please use one of the following: " << endl;
+        for (const auto& alg : allAlgorithms) {
+            cout << alg << ", ";
+        }
+        cout << "or ALL for all algorithms, MRC for miss-ratio curves, SWEEP for parameter sweeps or GLOBAL for global replacement.\n";
+        return 1;
+    }
+    
+    return 0;
+}